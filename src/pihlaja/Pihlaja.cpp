@@ -473,8 +473,8 @@ void Pihlaja::reactToInput(const Input& input)
 	/*
 	if (input.getKeyState(KeySym::O))
 	{
-		LOG_F(INFO, "Destroy biggestId: %i", entitySystem.biggestId());
-		m_engine.destroyEntity((Id)getRandomInt(20, entitySystem.biggestId()));
+		LOG_F(INFO, "Destroy biggestIndex: %i", entitySystem.biggestIndex());
+		m_engine.destroyEntity(entitySystem.entityAtIndex(getRandomInt(20, entitySystem.biggestIndex())));
 	}
 	*/
 
@@ -509,6 +509,9 @@ void Pihlaja::onKeyEvent(const Input& input)
 			case KeySym::F1:		m_engine.modifyDebugSystem().toggleIsEnabled(); break;
 			case KeySym::F2:		m_uiSystem.toggleIsEnabled(); break;
 			case KeySym::F3:		m_engine.modifyRenderSystem().toggleRenderNormals(); break;
+			case KeySym::F4:		m_engine.modifyRayTracer().toggleReprojection(); break;
+			case KeySym::F7:		m_engine.modifyRayTracer().togglePrimaryHitCache(); break;
+			case KeySym::F8:		m_engine.modifyRayTracer().toggleFocusOnSelection(); break;
 			case KeySym::F5:
 				m_engine.modifySceneSystem().modifyActiveScene().modifyEditorSystem()
 					.modifyTransformTool().nextGizmoPivot(
@@ -551,6 +554,11 @@ void Pihlaja::onKeyEvent(const Input& input)
 			//RAE_OLD case KeySym::Y: m_rayTracer.toggleBufferQuality(); break;
 			case KeySym::P: m_engine.modifyRayTracer().toggleFastMode(); break;
 			case KeySym::H: m_engine.modifyRayTracer().toggleVisualizeFocusDistance(); break;
+			case KeySym::T: m_engine.modifyRayTracer().nextTileOrder(); break;
+			case KeySym::J: m_engine.modifyRayTracer().nextSamplerType(); break;
+			case KeySym::C: m_engine.modifyRayTracer().toggleVisualizeConvergence(); break;
+			case KeySym::X: m_engine.modifyRayTracer().toggleDenoise(); break;
+			case KeySym::Z: m_engine.modifyRayTracer().toggleLightSampling(); break;
 			//RAE_OLD case KeySym::_1: m_rayTracer.showScene(1); break;
 			//RAE_OLD case KeySym::_2: m_rayTracer.showScene(2); break;
 			//RAE_OLD case KeySym::_3: m_rayTracer.showScene(3); break;
@@ -581,8 +589,8 @@ void Pihlaja::updateDebugTexts()
 	g_debugSystem->showDebugText("Movement: Second mouse button, WASDQE, Arrows", Colors::white);
 	g_debugSystem->showDebugText("Raytracer mode: U autofocus, H visualize focus, ", Colors::white);
 	g_debugSystem->showDebugText("VB focus distance, NM aperture, KL bounces, ", Colors::white);
-	g_debugSystem->showDebugText("G debug view, Tab UI", Colors::white);
-	g_debugSystem->showDebugText("Y toggle resolution", Colors::white);
+	g_debugSystem->showDebugText("G debug view, Tab UI, F4 reprojection, F7 primary hit cache", Colors::white);
+	g_debugSystem->showDebugText("Y toggle resolution, T tile order, J sampler, C convergence, X denoise, Z light sampling", Colors::white);
 	g_debugSystem->showDebugText("");
 	g_debugSystem->showDebugText("Entities on scene: " + std::to_string(entitySystem.entityCount()));
 	g_debugSystem->showDebugText("Transforms: " + std::to_string(transformSystem.transformCount()));
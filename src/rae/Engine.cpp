@@ -14,6 +14,9 @@ using namespace rae;
 
 Engine* g_engine = nullptr;
 
+// How many components defragmentTablesAsync moves on each frame, over all of the systems.
+static const int DefragmentMovesPerFrame = 256;
+
 Engine::Engine() :
 	Engine("Rae Application", -1, -1)
 {
@@ -134,16 +137,20 @@ UpdateStatus Engine::update()
 		//	system->destroyEntities(m_destroyEntities);
 		//}
 		m_sceneSystem.destroyEntities(m_destroyEntities);
+		m_rayTracer.destroyEntities(m_destroyEntities);
 		m_destroyEntities.clear();
 	}
 
 	if (m_defragmentTables)
 	{
+		// Spread the work over several frames, so that big components don't cause a hitch.
+		int moveBudget = DefragmentMovesPerFrame;
+		bool isFragmented = false;
 		for (auto system : m_systems)
 		{
-			system->defragmentTables();
+			isFragmented = system->defragmentTablesStep(moveBudget) || isFragmented;
 		}
-		m_defragmentTables = false;
+		m_defragmentTables = isFragmented;
 	}
 
 	if (m_windowSystem.windowCount() == 0)
@@ -255,18 +262,15 @@ UpdateStatus Engine::update()
 
 				// We can only have 1 maximized 3D viewport at a time.
 				Id maximizedViewport = InvalidId;
-				query<Viewport>(viewports, [&](Id id, const Viewport& viewport)
+				join(viewports).query([&](Id id, const Viewport& viewport) -> bool
 				{
 					const Maximizer& maximizer = uiScene.getMaximizer(id);
-					if (maximizedViewport == InvalidId && maximizer.isMaximized())
+					if (maximizer.isMaximized())
 					{
 						maximizedViewport = id;
-
-						// RAE_TODO: make some querys breakable by returning a bool value if we should continue or not.
-						// return false;
+						return false; // Found it. Stop the query.
 					}
-					// RAE_TODO: continue:
-					//return true;
+					return true;
 				});
 
 				query<Viewport>(viewports, [&](Id id, const Viewport& viewport)
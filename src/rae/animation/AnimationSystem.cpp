@@ -80,13 +80,19 @@ AnimationSystem::AnimationSystem(
 
 UpdateStatus AnimationSystem::update()
 {
-	query<PositionAnimator>(m_positionAnimators, [&](Id id, PositionAnimator& anim)
+	const float time = static_cast<float>(m_time.time());
+
+	// Each animator only writes the position of its own entity, so they can run in parallel.
+	parallelQuery<PositionAnimator>(m_positionAnimators, m_updatedPositions,
+		[&](Id id, PositionAnimator& anim, Array<Id>& updatedIds)
 	{
-		anim.update(static_cast<float>(m_time.time()));
-		m_transformSystem.setLocalPosition(id, anim.value());
+		anim.update(time);
+		m_transformSystem.setLocalPositionDeferred(id, anim.value());
+		updatedIds.emplace_back(id);
 
 		//LOG_F(INFO, "anim: %i pos: %s", id, Utils::toString(anim.value()).c_str());
 	});
+	m_transformSystem.setLocalPositionsUpdated(m_updatedPositions);
 
 	for (auto&& timeline : m_animationTimelines)
 	{
@@ -2,6 +2,7 @@
 
 #include "rae/core/Types.hpp"
 #include "rae/entity/Table.hpp"
+#include "rae/entity/ParallelQuery.hpp"
 
 #include "rae/core/ISystem.hpp"
 #include <rae/animation/Animator.hpp>
@@ -170,6 +171,7 @@ private:
 	Array<UniquePtr<AnimationTimeline>> m_animationTimelines;
 
 	Table<PositionAnimator> m_positionAnimators;
+	DeferredUpdates m_updatedPositions;
 };
 
 }
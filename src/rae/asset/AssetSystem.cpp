@@ -144,6 +144,7 @@ const Material& AssetSystem::getMaterial(Id id) const
 
 Material& AssetSystem::modifyMaterial(Id id)
 {
+	m_materials.setUpdated(id);
 	return m_materials.modify(id);
 }
 
@@ -36,7 +36,9 @@ public:
 
 	void addMaterial(Id id, const Material& comp);
 	const Material& getMaterial(Id id) const;
+	// Marks the material as updated for this frame, so only use it for changing the material.
 	Material& modifyMaterial(Id id);
+	bool hasAnyMaterialChanged() const { return m_materials.isAnyUpdated(); }
 	bool isMaterial(Id id) { return m_materials.check(id); }
 
 	asset::Id createImage(int width, int height, bool initNanoVG = true);
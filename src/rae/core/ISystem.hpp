@@ -73,6 +73,22 @@ public:
 		}
 	}
 
+	// Defragments the tables a bit at a time. The moveBudget is shared with the other systems, and it is
+	// decreased by the number of moved items. Returns true if some of the tables still need defragmenting.
+	virtual bool defragmentTablesStep(int& moveBudget)
+	{
+		bool isFragmented = false;
+		for (auto&& table : m_tables)
+		{
+			if (moveBudget > 0)
+			{
+				moveBudget -= table->defragmentStep(moveBudget);
+			}
+			isFragmented = isFragmented || table->isFragmented();
+		}
+		return isFragmented;
+	}
+
 	virtual void addTable(ITable& table)
 	{
 		m_tables.push_back(&table);
@@ -1,4 +1,4 @@
-#include <random>
+#include <cmath>
 #include <algorithm>
 
 #include "Random.hpp"
@@ -6,22 +6,43 @@
 namespace rae
 {
 
-RandomGeneratorEngine g_randomEngine;
+// splitmix64 finalizer
+static uint64_t mixBits(uint64_t value)
+{
+	value ^= value >> 30;
+	value *= 0xbf58476d1ce4e5b9ULL;
+	value ^= value >> 27;
+	value *= 0x94d049bb133111ebULL;
+	value ^= value >> 31;
+	return value;
+}
+
+uint64_t randomSeed(uint64_t a, uint64_t b, uint64_t c)
+{
+	return mixBits(mixBits(mixBits(a) ^ b) ^ c);
+}
+
+Pcg32& threadRandom()
+{
+	static thread_local Pcg32 generator;
+	return generator;
+}
+
+void seedThreadRandom(uint64_t seed)
+{
+	threadRandom().setSeed(seed);
+}
 
 #ifdef _WIN32
 double drand48()
 {
-	return getRandom(0.0, 1.0);
+	return getRandom();
 }
 #endif
 
 float getRandom()
 {
-#ifdef _WIN32
-	return getRandom( 0.0f, 1.0f );
-#else
-	return drand48();
-#endif
+	return threadRandom().nextFloat();
 }
 
 float getRandom( float from, float to )
@@ -30,14 +51,15 @@ float getRandom( float from, float to )
 	{
 		std::swap(from, to);
 	}
-	static std::uniform_real_distribution<float> uniform_dist;
-	return uniform_dist( g_randomEngine, std::uniform_real_distribution<float>::param_type(from, to) );
+	return from + (to - from) * getRandom();
 }
 
 float getRandomDistribution(float mean, float deviation)
 {
-	static std::normal_distribution<float> normal_dist(mean, deviation);
-	return normal_dist(g_randomEngine, std::normal_distribution<float>::param_type(mean, deviation));
+	// Box-Muller transform. 1 - getRandom() is never 0, so the log is finite.
+	float u1 = 1.0f - getRandom();
+	float u2 = getRandom();
+	return mean + deviation * std::sqrt(-2.0f * std::log(u1)) * std::cos(6.2831853f * u2);
 }
 
 int getRandomInt( int from, int to )
@@ -46,8 +68,11 @@ int getRandomInt( int from, int to )
 	{
 		std::swap(from, to);
 	}
-	static std::uniform_int_distribution<int> uniform_dist;
-	return uniform_dist( g_randomEngine, std::uniform_int_distribution<int>::param_type(from, to) );
+	// Unsigned, as the range can be bigger than INT_MAX.
+	uint32_t range = uint32_t(to) - uint32_t(from) + 1u;
+	if (range == 0u) // The full int range.
+		return int(threadRandom().nextUint());
+	return int(uint32_t(from) + threadRandom().nextUint() % range);
 }
 
 } // end namespace rae
@@ -1,13 +1,60 @@
 #pragma once
 
-#include <random>
+#include <stdint.h>
 #include <algorithm>
 
 namespace rae
 {
 
-typedef std::mt19937 RandomGeneratorEngine;
-extern RandomGeneratorEngine g_randomEngine;
+// PCG32 (pcg-random.org): a small and fast generator with 16 bytes of state, which makes it cheap to have one
+// per thread, or to re-seed one for every pixel sample. The sequence only depends on the seed and the stream,
+// so the same seeds always give the same results, no matter which thread does the work.
+class Pcg32
+{
+public:
+	Pcg32(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL)
+	{
+		setSeed(seed, stream);
+	}
+
+	void setSeed(uint64_t seed, uint64_t stream = 0xda3e39cb94b95bdbULL)
+	{
+		m_state = 0u;
+		m_increment = (stream << 1u) | 1u; // Must be odd.
+		nextUint();
+		m_state += seed;
+		nextUint();
+	}
+
+	uint32_t nextUint()
+	{
+		uint64_t oldState = m_state;
+		m_state = oldState * 6364136223846793005ULL + m_increment;
+		uint32_t xorShifted = uint32_t(((oldState >> 18u) ^ oldState) >> 27u);
+		uint32_t rotation = uint32_t(oldState >> 59u);
+		return (xorShifted >> rotation) | (xorShifted << ((0u - rotation) & 31u));
+	}
+
+	// Uniform in [0, 1).
+	float nextFloat()
+	{
+		// The top 24 bits fill the mantissa of a float exactly, so this can't round up to 1.
+		return float(nextUint() >> 8) * (1.0f / 16777216.0f);
+	}
+
+protected:
+	uint64_t m_state;
+	uint64_t m_increment;
+};
+
+// Mixes a few counters, e.g. the pixel index, the sample number and a frame or scene seed, into one well
+// distributed seed, so that neighbouring pixels and samples get unrelated sequences.
+uint64_t randomSeed(uint64_t a, uint64_t b = 0, uint64_t c = 0);
+
+// The generator for the calling thread, which all of the functions below use. Each thread has its own,
+// so they don't need to be locked. Seed it with seedThreadRandom to get reproducible results.
+Pcg32& threadRandom();
+void seedThreadRandom(uint64_t seed);
 
 #ifdef _WIN32
 double drand48();
@@ -19,4 +66,4 @@ float getRandom( float from, float to );
 float getRandomDistribution(float mean, float deviation);
 int getRandomInt( int from, int to );
 
-} // end namespace ra
+} // end namespace rae
@@ -0,0 +1,104 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae/core/Random.hpp"
+#include "rae/core/ThreadPool.hpp"
+#include "rae/core/Types.hpp"
+
+#include <climits>
+
+using namespace rae;
+
+SCENARIO("Random unittest", "[rae][Random]")
+{
+	GIVEN( "generators with the same and different seeds" )
+	{
+		Pcg32 first(randomSeed(1, 2, 3));
+		Pcg32 same(randomSeed(1, 2, 3));
+		Pcg32 other(randomSeed(1, 2, 4));
+
+		int sameCount = 0;
+		int differentCount = 0;
+		bool allInRange = true;
+		for (int i = 0; i < 1000; ++i)
+		{
+			float value = first.nextFloat();
+			if (value == same.nextFloat())
+				sameCount++;
+			if (value != other.nextFloat())
+				differentCount++;
+			if (value < 0.0f || value >= 1.0f)
+				allInRange = false;
+		}
+
+		THEN( "the same seed gives the same sequence" )
+		{
+			REQUIRE(sameCount == 1000);
+		}
+
+		THEN( "a different seed gives a different sequence" )
+		{
+			REQUIRE(differentCount > 990);
+		}
+
+		THEN( "the values are in [0, 1)" )
+		{
+			REQUIRE(allInRange == true);
+		}
+	}
+
+	GIVEN( "work seeded per task on many threads" )
+	{
+		const int TaskCount = 256;
+		auto runTasks = [&](ThreadPool& pool)
+		{
+			Array<float> results(TaskCount);
+			pool.run(TaskCount, [&](int taskIndex)
+			{
+				seedThreadRandom(randomSeed(taskIndex, 7));
+				float sum = 0.0f;
+				for (int i = 0; i < 100; ++i)
+				{
+					sum += getRandom(-1.0f, 1.0f) + float(getRandomInt(0, 10));
+				}
+				results[taskIndex] = sum;
+			});
+			return results;
+		};
+
+		ThreadPool singleThread(1);
+		ThreadPool manyThreads(4);
+
+		THEN( "the results are identical regardless of the threads" )
+		{
+			REQUIRE(runTasks(singleThread) == runTasks(manyThreads));
+		}
+	}
+
+	GIVEN( "int ranges which are bigger than INT_MAX" )
+	{
+		bool allInRange = true;
+		bool anyNegative = false;
+		for (int i = 0; i < 1000; ++i)
+		{
+			int value = getRandomInt(-2000000000, 2000000000);
+			if (value < -2000000000 || value > 2000000000)
+				allInRange = false;
+			if (value < 0)
+				anyNegative = true;
+			getRandomInt(INT_MIN, INT_MAX);
+		}
+
+		THEN( "the ints stay in the range" )
+		{
+			REQUIRE(allInRange == true);
+			REQUIRE(anyNegative == true);
+			REQUIRE(getRandomInt(INT_MAX, INT_MAX) == INT_MAX);
+			REQUIRE(getRandomInt(INT_MIN, INT_MIN) == INT_MIN);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,131 @@
+#include "rae/core/ThreadPool.hpp"
+
+namespace rae
+{
+
+// Set for the threads which are currently running tasks of any pool, so that nested runs don't deadlock.
+static thread_local bool t_isRunningTasks = false;
+
+ThreadPool::ThreadPool(int threadCount)
+{
+	m_nextTask = 0;
+	m_finishedTasks = 0;
+
+	if (threadCount <= 0)
+	{
+		int hint = (int)std::thread::hardware_concurrency();
+		threadCount = (hint == 0 ? 8 : hint);
+	}
+
+	for (int i = 0; i < threadCount - 1; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_wakeUp.notify_all();
+
+	for (auto&& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::run(int taskCount, const std::function<void(int)>& task)
+{
+	if (taskCount <= 0)
+		return;
+
+	std::unique_lock<std::mutex> runLock(m_runMutex, std::defer_lock);
+	if (taskCount == 1 || m_workers.empty() || t_isRunningTasks || !runLock.try_lock())
+	{
+		for (int i = 0; i < taskCount; ++i)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_taskCount = taskCount;
+		m_nextTask = 0;
+		m_finishedTasks = 0;
+		m_generation++;
+	}
+	m_wakeUp.notify_all();
+
+	runTasks(task, taskCount);
+
+	// Wait for the tasks to finish, and for the workers to leave this run, so that none of them
+	// can pick up a task index from the next run while still holding on to this task.
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_allDone.wait(lock, [&]()
+	{
+		return m_finishedTasks == taskCount && m_activeWorkers == 0;
+	});
+	m_task = nullptr;
+	m_taskCount = 0;
+}
+
+void ThreadPool::runTasks(const std::function<void(int)>& task, int taskCount)
+{
+	t_isRunningTasks = true;
+	while (true)
+	{
+		int taskIndex = m_nextTask++;
+		if (taskIndex >= taskCount)
+			break;
+
+		task(taskIndex);
+		m_finishedTasks++;
+	}
+	t_isRunningTasks = false;
+}
+
+void ThreadPool::workerLoop()
+{
+	int seenGeneration = 0;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wakeUp.wait(lock, [&]()
+		{
+			return m_quit || (m_task != nullptr && m_generation != seenGeneration);
+		});
+
+		if (m_quit)
+			return;
+
+		seenGeneration = m_generation;
+		const std::function<void(int)>& task = *m_task;
+		int taskCount = m_taskCount;
+		m_activeWorkers++;
+
+		lock.unlock();
+		runTasks(task, taskCount);
+		lock.lock();
+
+		m_activeWorkers--;
+		if (m_activeWorkers == 0)
+		{
+			m_allDone.notify_all();
+		}
+	}
+}
+
+} // namespace rae
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "rae/core/Types.hpp"
+
+namespace rae
+{
+
+// A pool of persistent worker threads. Unlike parallel_for, which creates and joins new threads every time,
+// the workers are created once and sleep while there's no work.
+// Usage example:
+// ThreadPool::shared().run(taskCount, [&](int taskIndex)
+// {
+//     processTask(taskIndex);
+// });
+class ThreadPool
+{
+public:
+	// With threadCount 0 there will be one thread per hardware thread. The calling thread
+	// takes part in the work too, so one less worker thread is actually created.
+	ThreadPool(int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Number of threads working on a run, including the calling thread.
+	int threadCount() const { return (int)m_workers.size() + 1; }
+
+	// Calls task(taskIndex) for each taskIndex from 0 to taskCount - 1, and blocks until all of them are done.
+	// The tasks are handed out one by one, so they can have different costs. If called from inside a task,
+	// or while another thread is running this pool, the tasks are run on the calling thread instead.
+	void run(int taskCount, const std::function<void(int)>& task);
+
+	// A pool shared by the systems on the main thread.
+	static ThreadPool& shared();
+
+protected:
+	void workerLoop();
+	void runTasks(const std::function<void(int)>& task, int taskCount);
+
+	Array<std::thread>	m_workers;
+
+	std::mutex					m_runMutex; // Only one run at a time.
+	std::mutex					m_mutex;
+	std::condition_variable		m_wakeUp;
+	std::condition_variable		m_allDone;
+
+	// The current run. Protected by m_mutex.
+	const std::function<void(int)>* m_task = nullptr;
+	int		m_taskCount = 0;
+	int		m_generation = 0;
+	int		m_activeWorkers = 0;
+	bool	m_quit = false;
+
+	std::atomic<int>	m_nextTask;
+	std::atomic<int>	m_finishedTasks;
+};
+
+} // namespace rae
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+
+namespace rae
+{
+
+// Hands the latest value from one writer thread to one reader thread without locks. The writer fills the back
+// value and publishes it, the reader takes the latest published value to the front. Neither of them ever waits for
+// the other, and the values in between are skipped if the writer is faster.
+// Usage example:
+// Writer:
+//     fill(buffer.back());
+//     buffer.publish();
+// Reader:
+//     if (buffer.swapFront())
+//         show(buffer.front());
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() :
+		m_middle(1)
+	{
+	}
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// Only for the writer thread.
+	T& back() { return m_values[m_backIndex]; }
+	void publish()
+	{
+		// The back becomes the middle, marked as new, and the old middle is the next back.
+		int old = m_middle.exchange(m_backIndex | NewBit, std::memory_order_acq_rel);
+		m_backIndex = old & IndexMask;
+	}
+
+	// Only for the reader thread. Takes the latest published value to the front, if there's a new one.
+	bool swapFront()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & NewBit) == 0)
+			return false;
+
+		int old = m_middle.exchange(m_frontIndex, std::memory_order_acq_rel);
+		m_frontIndex = old & IndexMask;
+		return true;
+	}
+	const T& front() const { return m_values[m_frontIndex]; }
+	T& modifyFront() { return m_values[m_frontIndex]; }
+
+protected:
+	static const int IndexMask = 3;
+	static const int NewBit = 4;
+
+	T m_values[3];
+
+	int m_backIndex = 0; // Owned by the writer.
+	int m_frontIndex = 2; // Owned by the reader.
+	std::atomic<int> m_middle; // The index of the shared value, and NewBit when it hasn't been read yet.
+};
+
+} // namespace rae
@@ -0,0 +1,88 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include <thread>
+
+#include "rae/core/TripleBuffer.hpp"
+#include "rae/core/Types.hpp"
+
+using namespace rae;
+
+SCENARIO("TripleBuffer unittest", "[rae][TripleBuffer]")
+{
+	GIVEN( "a triple buffer on one thread" )
+	{
+		TripleBuffer<int> buffer;
+
+		THEN( "there's nothing new to read before the first publish" )
+		{
+			REQUIRE_FALSE( buffer.swapFront() );
+		}
+
+		THEN( "the reader gets the latest published value only once" )
+		{
+			buffer.back() = 1;
+			buffer.publish();
+			buffer.back() = 2;
+			buffer.publish();
+
+			REQUIRE( buffer.swapFront() );
+			REQUIRE( buffer.front() == 2 );
+			REQUIRE_FALSE( buffer.swapFront() );
+			REQUIRE( buffer.front() == 2 );
+
+			buffer.back() = 3;
+			buffer.publish();
+			REQUIRE( buffer.swapFront() );
+			REQUIRE( buffer.front() == 3 );
+		}
+	}
+
+	GIVEN( "a writer thread publishing arrays of increasing numbers" )
+	{
+		const int frameCount = 20000;
+		const int frameSize = 64;
+
+		TripleBuffer<Array<int>> buffer;
+		std::thread writer([&]()
+		{
+			for (int frame = 1; frame <= frameCount; ++frame)
+			{
+				Array<int>& values = buffer.back();
+				values.assign(frameSize, frame);
+				buffer.publish();
+			}
+		});
+
+		bool isTorn = false;
+		bool isBackwards = false;
+		int lastFrame = 0;
+		while (lastFrame < frameCount)
+		{
+			if (!buffer.swapFront())
+				continue;
+
+			const Array<int>& values = buffer.front();
+			for (int value : values)
+			{
+				if (value != values.front())
+					isTorn = true;
+			}
+			if (values.front() < lastFrame)
+				isBackwards = true;
+			lastFrame = values.front();
+		}
+		writer.join();
+
+		THEN( "the reader only sees whole frames, in order, up to the last one" )
+		{
+			REQUIRE_FALSE( isTorn );
+			REQUIRE_FALSE( isBackwards );
+			REQUIRE( lastFrame == frameCount );
+		}
+	}
+}
+
+#endif
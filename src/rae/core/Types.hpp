@@ -23,6 +23,19 @@ namespace rae
 	const Id InvalidId = 0;
 //}
 
+// An entity Id contains an index in the low bits and a generation in the high bits. The EntitySystem
+// re-uses the indices of destroyed entities, and bumps the generation every time, so that an old Id
+// for the same index can be told apart from the new one. The generation of the first use of an index is 0,
+// so those Ids are equal to their index. The sign bit is not used, so Ids stay positive.
+const int IdIndexBits = 22;
+const int IdIndexMask = (1 << IdIndexBits) - 1;
+const int IdGenerationBits = 9;
+const int IdGenerationMask = (1 << IdGenerationBits) - 1;
+
+inline int idIndex(Id id) { return id & IdIndexMask; }
+inline int idGeneration(Id id) { return (id >> IdIndexBits) & IdGenerationMask; }
+inline Id makeId(int index, int generation) { return (Id)(((generation & IdGenerationMask) << IdIndexBits) | index); }
+
 namespace asset
 {
 	using Id = int;
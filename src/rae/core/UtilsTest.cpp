@@ -4,6 +4,7 @@
 #include "rae/core/catch.hpp"
 
 #include "rae/core/Utils.hpp"
+#include "rae/core/ThreadPool.hpp"
 
 #include "loguru/loguru.hpp"
 
@@ -42,4 +43,48 @@ SCENARIO("Utils unittest", "[rae][Utils]")
 	}
 }
 
+SCENARIO("ThreadPool unittest", "[rae][ThreadPool]")
+{
+	GIVEN( "a thread pool and 1000 tasks" )
+	{
+		rae::ThreadPool pool(4);
+		REQUIRE(pool.threadCount() == 4);
+
+		std::vector<int> array(1000, 0);
+
+		int testTimes = 50;
+		for (int k = 0; k < testTimes; ++k)
+		{
+			pool.run((int)array.size(), [&](int i)
+			{
+				array[i] = array[i] + 1;
+			});
+		}
+
+		THEN( "every task is run once per run" )
+		{
+			bool allRight = true;
+			for (int value : array)
+			{
+				if (value != testTimes)
+					allRight = false;
+			}
+			REQUIRE(allRight == true);
+		}
+
+		THEN( "a nested run is done on the calling thread" )
+		{
+			std::atomic<int> count(0);
+			pool.run(8, [&](int i)
+			{
+				pool.run(8, [&](int j)
+				{
+					count++;
+				});
+			});
+			REQUIRE(count == 64);
+		}
+	}
+}
+
 #endif
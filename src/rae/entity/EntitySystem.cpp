@@ -1,4 +1,4 @@
-#include <algorithm>
+#include <cassert>
 
 #include "loguru/loguru.hpp"
 
@@ -6,13 +6,19 @@
 
 using namespace rae;
 
+// Keep some indices in the free list before re-using them, so that the generations wrap around slower.
+static const int MinFreeIndices = 1024;
+
 EntitySystem::EntitySystem(String owner) :
-	m_owner(owner),
-	m_nextId(InvalidId)
+	m_owner(owner)
 {
 	//LOG_F(INFO, "Init one EntitySystem for %s", owner.c_str());
 
-	Id emptyEntityId = createEntity(); // hack at index 0, id 1
+	// Index 0 is never used, because that Id would be InvalidId.
+	m_generations.emplace_back(0);
+	m_positions.emplace_back(-1);
+
+	Id emptyEntityId = createEntity(); // hack at index 1, id 1
 	//LOG_F(INFO, "Create empty hack entity at id: %i", emptyEntityId);
 }
 
@@ -23,46 +29,79 @@ EntitySystem::~EntitySystem()
 Id EntitySystem::createEntity()
 {
 	//LOG_F(INFO, "%s EntitySystem Creating entity.", m_owner.c_str());
-	Id id = getNextId();
+	int index;
+	if ((int)m_freeIndices.size() > MinFreeIndices)
+	{
+		index = m_freeIndices.front();
+		m_freeIndices.pop_front();
+	}
+	else
+	{
+		index = (int)m_generations.size();
+		if (index > IdIndexMask)
+		{
+			LOG_F(ERROR, "%s EntitySystem ran out of entity indices.", m_owner.c_str());
+			assert(false);
+			return InvalidId;
+		}
+		m_generations.emplace_back(0);
+		m_positions.emplace_back(-1);
+	}
+
+	Id id = makeId(index, m_generations[index]);
 	//LOG_F(INFO, "%s EntitySystem Creating entity: %i", m_owner.c_str(), (int)id);
+	m_positions[index] = (int)m_entities.size();
 	m_entities.emplace_back(id);
 	return id;
 }
 
 bool EntitySystem::isAlive(Id id) const
 {
-	auto it = std::find(m_entities.begin(), m_entities.end(), id);
-	if (it != m_entities.end())
-	{
-		return true;
-	}
-	return false;
+	return entityPosition(id) != -1;
 }
 
-void EntitySystem::destroyEntities(const Array<Id>& entities)
+int EntitySystem::entityPosition(Id id) const
 {
-	for (Id id : entities)
-	{
-		m_entities.erase(std::remove(m_entities.begin(), m_entities.end(), id), m_entities.end());
-	}
+	if (id <= InvalidId)
+		return -1;
+
+	int index = idIndex(id);
+	if (index >= (int)m_generations.size() || m_generations[index] != idGeneration(id))
+		return -1;
+
+	return m_positions[index];
 }
 
-Id EntitySystem::biggestId() const
+Id EntitySystem::entityAtIndex(int index) const
 {
-	Id biggest = 0;
-	for (Id id : m_entities)
-	{
-		if (id > biggest)
-			biggest = id;
-	}
-	return biggest;
+	if (index <= 0 || index >= (int)m_positions.size() || m_positions[index] == -1)
+		return InvalidId;
+
+	return m_entities[m_positions[index]];
 }
 
-Id EntitySystem::getNextId()
+void EntitySystem::destroyEntity(Id id)
 {
-	//LOG_F(INFO, "getNextId. Going to inc: %i", (int)m_nextId);
-	++m_nextId;
-	//LOG_F(INFO, "getNextId. Going to return: %i", (int)m_nextId);
+	int position = entityPosition(id);
+	if (position == -1)
+		return;
+
+	// Move the last entity to the hole.
+	Id lastId = m_entities.back();
+	m_entities[position] = lastId;
+	m_positions[idIndex(lastId)] = position;
+	m_entities.pop_back();
 
-	return m_nextId;
+	int index = idIndex(id);
+	m_positions[index] = -1;
+	m_generations[index] = (m_generations[index] + 1) & IdGenerationMask;
+	m_freeIndices.emplace_back(index);
+}
+
+void EntitySystem::destroyEntities(const Array<Id>& entities)
+{
+	for (Id id : entities)
+	{
+		destroyEntity(id);
+	}
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <deque>
+
 #include "rae/core/Types.hpp"
 
 namespace rae
@@ -9,7 +11,9 @@ struct Entity
 {
 };
 
-/// Create and destroy entities and handle their lifetimes. TODO Pooling of Ids.
+/// Create and destroy entities and handle their lifetimes.
+/// The indices of destroyed entities are re-used, with a new generation in the Id (see idIndex and idGeneration),
+/// so isAlive returns false for the Ids of destroyed entities, even after their index has been re-used.
 class EntitySystem
 {
 public:
@@ -19,24 +23,35 @@ public:
 	EntitySystem(EntitySystem&&) = default;
 
 	Id createEntity();
+	void destroyEntity(Id id);
 	void destroyEntities(const Array<Id>& entities);
 
 	bool isAlive(Id id) const;
 
-	Id biggestId() const;
+	// The biggest index that has been used by an Id. Note that this is not an Id itself.
+	int biggestIndex() const { return (int)m_generations.size() - 1; }
 	int entityCount() const { return (int)m_entities.size(); }
+	// The alive entities. The order changes when entities are destroyed.
 	const Array<Id>& entities() const { return m_entities; }
+	// The position of an alive entity in entities(), or -1.
+	int entityPosition(Id id) const;
+	// The Id of the alive entity with the index, or InvalidId.
+	Id entityAtIndex(int index) const;
 
 	const String& owner() { return m_owner; }
 
-	Id getNextId();
-
 protected:
 	String		m_owner = "";
 
-	Id			m_nextId = 0;
-
 	Array<Id>	m_entities;
+
+	// These are indexed with the index part of an Id.
+	Array<int>	m_generations; // The generation of the current or the next Id with the index.
+	Array<int>	m_positions; // Position in m_entities, or -1 if the index is not in use.
+
+	// The indices of destroyed entities. The oldest ones are re-used first, so that it takes
+	// as long as possible before an index comes back.
+	std::deque<int> m_freeIndices;
 };
 
 }
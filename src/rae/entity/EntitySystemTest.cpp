@@ -0,0 +1,102 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae/entity/EntitySystem.hpp"
+#include "rae/entity/Table.hpp"
+
+using namespace rae;
+
+SCENARIO("EntitySystem unittest", "[rae][EntitySystem]")
+{
+	GIVEN( "an entity system with some entities" )
+	{
+		EntitySystem entitySystem("test");
+		REQUIRE(entitySystem.entityCount() == 1); // The hack entity.
+
+		Array<Id> ids;
+		for (int i = 0; i < 10; ++i)
+		{
+			ids.emplace_back(entitySystem.createEntity());
+		}
+
+		REQUIRE(entitySystem.entityCount() == 11);
+		REQUIRE(ids.front() == 2);
+		REQUIRE(ids.back() == 11);
+		REQUIRE(entitySystem.isAlive(5) == true);
+		REQUIRE(entitySystem.isAlive(12) == false);
+
+		WHEN( "entities are destroyed" )
+		{
+			entitySystem.destroyEntities({ 3, 7 });
+
+			THEN( "they are not alive, and the rest are still found" )
+			{
+				REQUIRE(entitySystem.entityCount() == 9);
+				REQUIRE(entitySystem.isAlive(3) == false);
+				REQUIRE(entitySystem.isAlive(7) == false);
+				for (Id id : entitySystem.entities())
+				{
+					REQUIRE(entitySystem.isAlive(id) == true);
+					REQUIRE(entitySystem.entities()[entitySystem.entityPosition(id)] == id);
+				}
+				REQUIRE(entitySystem.entityAtIndex(11) == 11);
+				REQUIRE(entitySystem.entityAtIndex(7) == InvalidId);
+			}
+		}
+
+		WHEN( "many entities are created and destroyed" )
+		{
+			Table<int> table;
+			Id firstId = ids.front();
+			table.assign(firstId, 1);
+			entitySystem.destroyEntity(firstId);
+			table.remove(firstId);
+
+			// Churn until the index of the first entity is re-used.
+			Id reusedId = InvalidId;
+			for (int i = 0; i < 5000 && reusedId == InvalidId; ++i)
+			{
+				Id id = entitySystem.createEntity();
+				if (idIndex(id) == idIndex(firstId))
+					reusedId = id;
+				else entitySystem.destroyEntity(id);
+			}
+
+			THEN( "the index is re-used with a new generation, and the old Id stays dead" )
+			{
+				REQUIRE(reusedId != InvalidId);
+				REQUIRE(reusedId != firstId);
+				REQUIRE(idGeneration(reusedId) == 1);
+				REQUIRE(entitySystem.isAlive(reusedId) == true);
+				REQUIRE(entitySystem.isAlive(firstId) == false);
+				REQUIRE(entitySystem.biggestIndex() < 2000);
+
+				table.assign(reusedId, 2);
+				REQUIRE(table.check(reusedId) == true);
+				REQUIRE(table.check(firstId) == false);
+				REQUIRE(table.get(reusedId) == 2);
+			}
+		}
+	}
+
+	GIVEN( "a table with a component of a destroyed generation" )
+	{
+		Table<int> table;
+		Id oldId = makeId(5, 0);
+		Id newId = makeId(5, 1);
+		table.assign(oldId, 1);
+		table.assign(newId, 2);
+
+		THEN( "the stale component is dropped" )
+		{
+			REQUIRE(table.count() == 1);
+			REQUIRE(table.check(oldId) == false);
+			REQUIRE(table.get(newId) == 2);
+			REQUIRE(table.ids().size() == 1);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+
+#include "rae/core/ThreadPool.hpp"
+#include "rae/entity/Table.hpp"
+
+namespace rae
+{
+
+const int CacheLineSize = 64;
+
+// The number of items in a chunk is a multiple of this, so that the chunks start on a cache line boundary
+// in the dense storage (relative to the start of the array), also for the one byte updated flags.
+const int ParallelQueryChunkAlignment = CacheLineSize;
+// Below this the overhead of waking up the workers is bigger than the work itself.
+const int ParallelQueryMinChunkSize = 256;
+
+// The Ids to be marked as updated from the chunks of a parallelQuery. Each chunk has its own list,
+// so the workers don't need to lock anything and they don't write to the shared updated flags of a Table.
+// The lists are then applied to a Table on the calling thread after the parallel part is done.
+class DeferredUpdates
+{
+public:
+	void reset(int chunkCount)
+	{
+		m_chunks.resize(chunkCount);
+		for (auto&& chunk : m_chunks)
+		{
+			chunk.ids.clear();
+		}
+	}
+
+	Array<Id>& chunk(int chunkIndex) { return m_chunks[chunkIndex].ids; }
+
+	template <typename Func>
+	void forEach(Func&& process) const
+	{
+		for (auto&& chunk : m_chunks)
+		{
+			for (Id id : chunk.ids)
+			{
+				process(id);
+			}
+		}
+	}
+
+	template <typename Comp>
+	void apply(Table<Comp>& table) const
+	{
+		forEach([&](Id id)
+		{
+			table.setUpdatedF(id);
+		});
+	}
+
+protected:
+	struct Chunk
+	{
+		Array<Id> ids;
+		// Keep the array headers of neighbouring chunks on different cache lines.
+		char padding[CacheLineSize];
+	};
+
+	Array<Chunk> m_chunks;
+};
+
+inline int parallelQueryChunkSize(int itemCount, int threadCount)
+{
+	// A few chunks per thread, so that the threads can balance uneven chunks between them.
+	int chunkCount = threadCount * 4;
+	int chunkSize = std::max((itemCount + chunkCount - 1) / chunkCount, ParallelQueryMinChunkSize);
+	return ((chunkSize + ParallelQueryChunkAlignment - 1) / ParallelQueryChunkAlignment) * ParallelQueryChunkAlignment;
+}
+
+// A parallel version of queryItems for work where each item is independent. The dense storage of the table
+// is split into chunks, which are processed on the pool. The process function must not add or remove
+// components or set updated flags, as the tables are shared between the threads.
+// Usage example:
+// parallelQuery<Particle>(particles, [&](Id id, Particle& particle)
+// {
+//     particle.update(deltaTime);
+// });
+template <typename Comp, typename Func>
+void parallelQuery(Table<Comp>& table, Func&& process, ThreadPool& pool = ThreadPool::shared())
+{
+	const Array<Id>& ids = table.denseIds();
+	Array<Comp>& items = table.items();
+	const int itemCount = (int)ids.size();
+	const int chunkSize = parallelQueryChunkSize(itemCount, pool.threadCount());
+	const int chunkCount = (itemCount + chunkSize - 1) / chunkSize;
+
+	pool.run(chunkCount, [&](int chunkIndex)
+	{
+		const int begin = chunkIndex * chunkSize;
+		const int end = std::min(begin + chunkSize, itemCount);
+		for (int i = begin; i < end; ++i)
+		{
+			if (ids[i] != InvalidId)
+			{
+				process(ids[i], items[i]);
+			}
+		}
+	});
+}
+
+// Same as above, but the process function gets a chunk local list of Ids: process(Id, Comp&, Array<Id>& updatedIds).
+// The Ids added to the list are collected into the updates, which can be applied to any table with
+// DeferredUpdates::apply after this returns.
+template <typename Comp, typename Func>
+void parallelQuery(Table<Comp>& table, DeferredUpdates& updates, Func&& process, ThreadPool& pool = ThreadPool::shared())
+{
+	const Array<Id>& ids = table.denseIds();
+	Array<Comp>& items = table.items();
+	const int itemCount = (int)ids.size();
+	const int chunkSize = parallelQueryChunkSize(itemCount, pool.threadCount());
+	const int chunkCount = (itemCount + chunkSize - 1) / chunkSize;
+
+	updates.reset(chunkCount);
+
+	pool.run(chunkCount, [&](int chunkIndex)
+	{
+		Array<Id>& updatedIds = updates.chunk(chunkIndex);
+		const int begin = chunkIndex * chunkSize;
+		const int end = std::min(begin + chunkSize, itemCount);
+		for (int i = begin; i < end; ++i)
+		{
+			if (ids[i] != InvalidId)
+			{
+				process(ids[i], items[i], updatedIds);
+			}
+		}
+	});
+}
+
+} // namespace rae
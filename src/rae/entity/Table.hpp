@@ -3,18 +3,129 @@
 #include "rae/core/Types.hpp"
 #include "loguru/loguru.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <functional>
+#include <tuple>
+#include <type_traits>
 
 namespace rae
 {
 
 const int InvalidIndex = -1;
 
+// The updated flag of an item is a set of bits, so that a component can track changes to its parts
+// separately, like the position and rotation of a Transform. Without a mask, all the bits are used.
+using UpdateMask = uint8_t;
+const UpdateMask AllChannels = 0xFF;
+
+// The IdMap is split into pages of this many Id indices.
+const int IdMapPageBits = 10;
+const int IdMapPageSize = 1 << IdMapPageBits;
+const int IdMapPageMask = IdMapPageSize - 1;
+
+// A paged sparse map from an Id to an index in a dense array. A page is allocated when the first Id in
+// its range is set, and it is freed again when the last one is reset. So the memory usage depends on how
+// many Ids are mapped (and how they are clustered), and not on the biggest Id in the World.
+// The map is keyed by the index part of the Id only, so the generations of an Id share the same entry.
+// The user of the map has to check that the entry belongs to the right generation, like Table does.
+class IdMap
+{
+public:
+	// Returns the index for the Id, or InvalidIndex if the Id is not mapped.
+	int get(Id id) const
+	{
+		if (id < 0)
+			return InvalidIndex;
+		int key = idIndex(id);
+		int page = key >> IdMapPageBits;
+		if (page >= (int)m_pages.size() || m_pages[page].empty())
+			return InvalidIndex;
+		return m_pages[page][key & IdMapPageMask];
+	}
+
+	void set(Id id, int index)
+	{
+		assert(id >= 0);
+		assert(index != InvalidIndex);
+
+		int key = idIndex(id);
+		int page = key >> IdMapPageBits;
+		if (page >= (int)m_pages.size())
+		{
+			m_pages.resize(page + 1);
+			m_pageCounts.resize(page + 1, 0);
+		}
+
+		Array<int>& entries = m_pages[page];
+		if (entries.empty())
+		{
+			entries.assign(IdMapPageSize, InvalidIndex);
+		}
+
+		int& entry = entries[key & IdMapPageMask];
+		if (entry == InvalidIndex)
+		{
+			m_pageCounts[page]++;
+		}
+		entry = index;
+	}
+
+	void reset(Id id)
+	{
+		if (id < 0)
+			return;
+		int key = idIndex(id);
+		int page = key >> IdMapPageBits;
+		if (page >= (int)m_pages.size() || m_pages[page].empty())
+			return;
+
+		int& entry = m_pages[page][key & IdMapPageMask];
+		if (entry == InvalidIndex)
+			return;
+
+		entry = InvalidIndex;
+		m_pageCounts[page]--;
+		if (m_pageCounts[page] == 0)
+		{
+			// Release the memory of the now empty page.
+			Array<int>().swap(m_pages[page]);
+		}
+	}
+
+	void clear()
+	{
+		m_pages.clear();
+		m_pageCounts.clear();
+	}
+
+	int allocatedPageCount() const
+	{
+		int result = 0;
+		for (auto&& entries : m_pages)
+		{
+			if (!entries.empty())
+				result++;
+		}
+		return result;
+	}
+
+protected:
+	Array<Array<int>> m_pages; // An empty page is not allocated.
+	Array<int> m_pageCounts; // Number of valid entries on each page.
+};
+
 class ITable
 {
 public:
+	// Same as Table::check, for when the component type is not known.
+	virtual bool contains(Id id) const = 0;
 	virtual void removeEntities(const Array<Id>& entities) = 0;
 	virtual void defragment() = 0;
+	// Moves at most maxMoves items, and returns the number of items moved. See Table::defragmentStep.
+	virtual int defragmentStep(int maxMoves) = 0;
+	virtual bool isFragmented() const = 0;
 	virtual void onFrameEnd() = 0;
 };
 
@@ -39,16 +150,16 @@ class Table : public ITable
 public:
 	Table(int reserveSize = 10)
 	{
-		m_idMap.reserve(reserveSize);
-		m_items.reserve(reserveSize);
+		reserve(reserveSize);
 	}
 
 	Table(Table&&) = default;
 
 	void reserve(int reserveSize)
 	{
-		m_idMap.reserve(reserveSize);
 		m_items.reserve(reserveSize);
+		m_ids.reserve(reserveSize);
+		m_updated.reserve(reserveSize);
 	}
 
 	// Hmm, get rid of one of these...
@@ -64,123 +175,54 @@ public:
 
 	void assign(Id id, Comp&& comp)
 	{
-		if (check(id))
+		int index = indexOf(id);
+		if (index != InvalidIndex)
 		{
-			m_items[m_idMap[id]] = std::move(comp);
+			m_items[index] = std::move(comp);
 			setUpdatedF(id);
 
 			//LOG_F(INFO, "Table: Entity already exists, replacing: %i", id);
 			return;
 		}
 
-		m_count++;
-
-		// Reserve enough space in idMap to hold the id.
-		//LOG_F(INFO, "Creating id: %i size: %i", id, (int)m_idMap.size());
-		int index = (int)id;
-		while ((int)m_idMap.size() <= index)
-		{
-			m_idMap.emplace_back(InvalidIndex);
-			//LOG_F(INFO, "Created: %i", (int)m_idMap.size());
-		}
-		//LOG_F(INFO, "Size after: %i", (int)m_idMap.size());
-
-		// Find next free place
-		if (m_freeItems.size() > 0)
-		{
-			int freeIndex = m_freeItems.back();
-			m_freeItems.pop_back();
-			m_idMap[id] = freeIndex;
-			m_items[freeIndex] = std::move(comp);
-			// setUpdated free index:
-			m_updated[freeIndex] = true;
-			m_anyUpdated = true;
-
-			//LOG_F(INFO, "Table: Re-used existing entity: id: %i at freeindex: %i", id, freeIndex);
-			return;
-		}
-
-		// else we need to create a new one.
-		m_idMap[index] = (int)m_items.size();
-
-		m_items.emplace_back(std::move(comp));
-		// setUpdated new entity
-		m_updated.emplace_back(true);
-		m_anyUpdated = true;
-
-		//LOG_F(INFO, "Table: Created a completely new object: %i idMap.size: %i", id, (int)m_idMap.size());
+		createItem(id, std::move(comp));
 	}
 
 	void assign(Id id, const Comp& comp)
 	{
-		if (check(id))
+		int index = indexOf(id);
+		if (index != InvalidIndex)
 		{
-			m_items[m_idMap[id]] = std::move(comp);
+			m_items[index] = comp;
 			setUpdatedF(id);
 
 			//LOG_F(INFO, "Table: Entity already exists, replacing: %i", id);
 			return;
 		}
 
-		m_count++;
-
-		// Reserve enough space in idMap to hold the id.
-		//LOG_F(INFO, "Creating id: %i size: %i", id, (int)m_idMap.size());
-		int index = (int)id;
-		while ((int)m_idMap.size() <= index)
-		{
-			m_idMap.emplace_back(InvalidIndex);
-			//LOG_F(INFO, "Created: %i", (int)m_idMap.size());
-		}
-		//LOG_F(INFO, "Size after: %i", (int)m_idMap.size());
-
-		// Find next free place
-		if (m_freeItems.size() > 0)
-		{
-			int freeIndex = m_freeItems.back();
-			m_freeItems.pop_back();
-			m_idMap[id] = freeIndex;
-			m_items[freeIndex] = std::move(comp);
-			// setUpdated free index:
-			m_updated[freeIndex] = true;
-			m_anyUpdated = true;
-
-			//LOG_F(INFO, "Table: Re-used existing entity: id: %i at freeindex: %i", id, freeIndex);
-			return;
-		}
-
-		// else we need to create a new one.
-		m_idMap[index] = (int)m_items.size();
-
-		m_items.emplace_back(std::move(comp));
-		// setUpdated new entity
-		m_updated.emplace_back(true);
-		m_anyUpdated = true;
-
-		//LOG_F(INFO, "Table: Created a completely new object: %i idMap.size: %i", id, (int)m_idMap.size());
+		createItem(id, comp);
 	}
 
 	void clear()
 	{
 		m_count = 0;
 		m_items.clear();
+		m_ids.clear();
 		m_idMap.clear();
 		m_freeItems.clear();
 		m_updated.clear(); // It is a bit wrong to clear the updated here, but we can't do anything else either.
+		m_updatedIndices.clear();
 		m_anyUpdated = true; // And this might be unexpected or not.
 	}
 
 	// This remove is currently quite "lazy", so it doesn't actually remove the item, but just
-	// marks it as free. This is also currently the reason why we need to count the items separately
-	// (and also because we are using array idMap instead of a proper unordered_map which would tell
-	// the count easily).
+	// marks it as free. This is also currently the reason why we need to count the items separately.
 	void remove(Id id)
 	{
-		if (check(id))
+		int index = indexOf(id);
+		if (index != InvalidIndex)
 		{
-			m_freeItems.emplace_back(m_idMap[id]);
-			m_idMap[id] = InvalidIndex;
-			m_count--;
+			freeItem(index);
 		}
 	}
 
@@ -192,42 +234,78 @@ public:
 		}
 	}
 
+	// Removes the free holes from the dense arrays. Keeps the relative order of the items.
 	void defragment() override
 	{
 		m_freeItems.clear();
-
-		// Count valid entities
-		int validEntities = 0;
-		for (auto&& index : m_idMap)
-		{
-			if (index != InvalidIndex)
-				validEntities++;
-		}
+		m_updatedIndices.clear();
 
 		Array<Comp> newItems;
-		newItems.reserve(validEntities);
+		newItems.reserve(m_count);
+		Array<Id> newIds;
+		newIds.reserve(m_count);
+		Array<UpdateMask> newUpdated;
+		newUpdated.reserve(m_count);
 
-		for (int i = 0; i < (int)m_idMap.size(); ++i)
+		for (int i = 0; i < (int)m_ids.size(); ++i)
 		{
-			int index = m_idMap[i];
-			if (index != InvalidIndex)
+			Id id = m_ids[i];
+			if (id != InvalidId)
 			{
-				newItems.emplace_back(std::move(m_items[index]));
-				m_idMap[i] = (int)newItems.size()-1;
+				if (m_updated[i])
+					m_updatedIndices.emplace_back((int)newItems.size());
+				m_idMap.set(id, (int)newItems.size());
+				newItems.emplace_back(std::move(m_items[i]));
+				newIds.emplace_back(id);
+				newUpdated.emplace_back(m_updated[i]);
 			}
 		}
 
 		m_items = std::move(newItems);
+		m_ids = std::move(newIds);
+		m_updated = std::move(newUpdated);
+	}
+
+	// An incremental version of defragment. Moves at most maxMoves items from the end of the dense arrays
+	// to the free holes, and drops the free items from the end. Call this once per frame until isFragmented
+	// returns false, so that there's no frame which has to move the whole table. Doesn't keep the order of the items.
+	int defragmentStep(int maxMoves) override
+	{
+		int moves = 0;
+		trimFreeTail();
+		while (moves < maxMoves && !m_freeItems.empty())
+		{
+			int hole = m_freeItems.back();
+			m_freeItems.pop_back();
+			// Free items at the end have been dropped already by trimFreeTail.
+			if (hole >= (int)m_ids.size())
+				continue;
+
+			// After trimming, the last item is always in use.
+			int last = (int)m_ids.size() - 1;
+			moveItem(last, hole);
+			moves++;
+
+			trimFreeTail();
+		}
+		return moves;
+	}
+
+	bool isFragmented() const override
+	{
+		return m_count != (int)m_ids.size();
 	}
 
 	void printInfo()
 	{
-		LOG_F(INFO, "m_idMap size: %i", (int)m_idMap.size());
-		for (auto&& index : m_idMap)
+		LOG_F(INFO, "m_idMap allocated pages: %i", m_idMap.allocatedPageCount());
+
+		LOG_F(INFO, "m_ids size: %i", (int)m_ids.size());
+		for (auto&& id : m_ids)
 		{
-			if (index != InvalidIndex)
-				LOG_F(INFO, "idMap OK: %i", (int)index);
-			else LOG_F(INFO, "idMap INVALID: %i", (int)index);
+			if (id != InvalidId)
+				LOG_F(INFO, "id OK: %i index: %i", (int)id, m_idMap.get(id));
+			else LOG_F(INFO, "id INVALID (free item)");
 		}
 
 		LOG_F(INFO, "m_freeItems size: %i", (int)m_freeItems.size());
@@ -239,20 +317,22 @@ public:
 		}
 
 		LOG_F(INFO, "m_items size: %i", (int)m_items.size());
-		int i = 0;
-		for (auto&& item : m_items)
-		{
-			LOG_F(INFO, "item: %i", i);
-			++i;
-		}
 	}
 
+	// Note that the items array can contain free items, which don't belong to any Id.
+	// Use denseIds() to find out which items are in use.
 	const Array<Comp>& items() const { return m_items; }
 	Array<Comp>& items() { return m_items; }
 
+	// Parallel to items(). Contains the Id of each item, or InvalidId for free items.
+	const Array<Id>& denseIds() const { return m_ids; }
+
+	const IdMap& idMap() const { return m_idMap; }
+
 	Array<Id> ids() const
 	{
 		Array<Id> result;
+		result.reserve(m_count);
 		query<Comp>(*this, [&](Id id)
 		{
 			result.emplace_back(id);
@@ -260,22 +340,36 @@ public:
 		return result;
 	}
 
+	bool contains(Id id) const override
+	{
+		return check(id);
+	}
+
 	// Check for existance of the component for the given Id
 	bool check(Id id) const
 	{
-		int index = (int)id;
-		if (index < (int)m_idMap.size() && m_idMap[index] != InvalidIndex)
+		return indexOf(id) != InvalidIndex;
+	}
+
+	// Returns the index of the item of the Id in items(), or InvalidIndex. An Id with an old generation
+	// is not found, even if its index has been re-used by a newer entity.
+	int indexOf(Id id) const
+	{
+		int index = m_idMap.get(id);
+		if (index != InvalidIndex)
 		{
-			assert(m_idMap[index] < (int)m_items.size()); // "idMap index must be smaller than table items size."
-			return true;
+			assert(index < (int)m_items.size()); // "idMap index must be smaller than table items size."
+			if (m_ids[index] == id)
+				return index;
 		}
-		return false;
+		return InvalidIndex;
 	}
 
 	const Comp& get(Id id) const
 	{
-		if (check(id))
-			return m_items[m_idMap[id]];
+		int index = indexOf(id);
+		if (index != InvalidIndex)
+			return m_items[index];
 		//LOG_F(ERROR, "Table: invalid get: %i", id);
 		//assert(false);
 		return m_empty;
@@ -283,8 +377,9 @@ public:
 
 	Comp& modify(Id id)
 	{
-		if (check(id))
-			return m_items[m_idMap[id]];
+		int index = indexOf(id);
+		if (index != InvalidIndex)
+			return m_items[index];
 		//LOG_F(ERROR, "Table: invalid get: %i", id);
 		//assert(false);
 		return m_empty;
@@ -292,12 +387,12 @@ public:
 
 	const Comp& getF(Id id) const
 	{
-		return m_items[m_idMap[id]];
+		return m_items[m_idMap.get(id)];
 	}
 
 	Comp& modifyF(Id id)
 	{
-		return m_items[m_idMap[id]];
+		return m_items[m_idMap.get(id)];
 	}
 
 	// To be called on every frame
@@ -306,46 +401,53 @@ public:
 		clearUpdated();
 	}
 
-	// The updated flags should be cleared at the end of each frame
+	// The updated flags should be cleared at the end of each frame. Only the flags which were
+	// set are touched, so this costs nothing for a table which didn't change.
 	void clearUpdated()
 	{
-		for (auto&& value : m_updated)
+		for (int index : m_updatedIndices)
 		{
-			value = false;
+			m_updated[index] = 0;
 		}
+		m_updatedIndices.clear();
 		m_anyUpdated = false;
 	}
 
+	// The indices of the items which have been marked as updated since the last clearUpdated, each only once.
+	// Can contain indices of free items, if the item was removed after the update. See queryUpdated.
+	const Array<int>& updatedIndices() const { return m_updatedIndices; }
+
 	bool isAnyUpdated() const
 	{
 		return m_anyUpdated;
 	}
 
-	bool isUpdated(Id id) const
+	// True if any of the bits in the mask have been updated.
+	bool isUpdated(Id id, UpdateMask mask = AllChannels) const
 	{
-		if (check(id))
-			return m_updated[m_idMap[id]];
+		int index = indexOf(id);
+		if (index != InvalidIndex)
+			return (m_updated[index] & mask) != 0;
 		return false;
 	}
 
-	bool isUpdatedF(Id id) const
+	bool isUpdatedF(Id id, UpdateMask mask = AllChannels) const
 	{
-		return m_updated[m_idMap[id]];
+		return (m_updated[m_idMap.get(id)] & mask) != 0;
 	}
 
-	void setUpdated(Id id)
+	void setUpdated(Id id, UpdateMask mask = AllChannels)
 	{
-		if (check(id))
+		int index = indexOf(id);
+		if (index != InvalidIndex)
 		{
-			m_updated[m_idMap[id]] = true;
-			m_anyUpdated = true;
+			markUpdated(index, mask);
 		}
 	}
 
-	void setUpdatedF(Id id)
+	void setUpdatedF(Id id, UpdateMask mask = AllChannels)
 	{
-		m_updated[m_idMap[id]] = true;
-		m_anyUpdated = true;
+		markUpdated(m_idMap.get(id), mask);
 	}
 
 	friend void query<Comp>(Table<Comp>& table, std::function<void(Id, Comp&)> process);
@@ -355,31 +457,151 @@ public:
 
 protected:
 
+	// Finds a place for a new item for the Id, either from the free items, or by creating a new one.
+	// The new item is marked as updated.
+	template <typename CompRef>
+	void createItem(Id id, CompRef&& comp)
+	{
+		// A component of an older generation of the Id was not removed when its entity was destroyed.
+		// Drop it, so that it doesn't show up in the queries with a dead Id.
+		int staleIndex = m_idMap.get(id);
+		if (staleIndex != InvalidIndex)
+		{
+			freeItem(staleIndex);
+		}
+
+		m_count++;
+
+		// The free items at the end might have been dropped by defragmentStep.
+		while (!m_freeItems.empty() && m_freeItems.back() >= (int)m_ids.size())
+		{
+			m_freeItems.pop_back();
+		}
+
+		int index;
+		if (m_freeItems.size() > 0)
+		{
+			index = m_freeItems.back();
+			m_freeItems.pop_back();
+			m_items[index] = std::forward<CompRef>(comp);
+			m_ids[index] = id;
+
+			//LOG_F(INFO, "Table: Re-used existing entity: id: %i at freeindex: %i", id, index);
+		}
+		else
+		{
+			index = (int)m_items.size();
+			m_items.emplace_back(std::forward<CompRef>(comp));
+			m_ids.emplace_back(id);
+			m_updated.emplace_back(0);
+
+			//LOG_F(INFO, "Table: Created a completely new object: %i", id);
+		}
+
+		m_idMap.set(id, index);
+		markUpdated(index, AllChannels);
+	}
+
+	// Moves the item at index from to the free index to, and removes the last item, which must be from.
+	void moveItem(int from, int to)
+	{
+		assert(from == (int)m_ids.size() - 1);
+		assert(m_ids[to] == InvalidId);
+
+		Id id = m_ids[from];
+		m_items[to] = std::move(m_items[from]);
+		m_ids[to] = id;
+		m_idMap.set(id, to);
+
+		// The old item in the hole can also have been updated before it was removed.
+		if (m_updated[from] || m_updated[to])
+		{
+			// The list is only as long as the number of updates on this frame.
+			m_updatedIndices.erase(std::remove_if(m_updatedIndices.begin(), m_updatedIndices.end(),
+				[from, to](int index) { return index == from || index == to; }), m_updatedIndices.end());
+			m_updated[to] = 0;
+			if (m_updated[from])
+			{
+				markUpdated(to, m_updated[from]);
+			}
+		}
+
+		m_items.pop_back();
+		m_ids.pop_back();
+		m_updated.pop_back();
+	}
+
+	// Drops the free items from the end of the dense arrays. Their indices in m_freeItems are left behind,
+	// and are skipped when they come up.
+	void trimFreeTail()
+	{
+		int oldSize = (int)m_ids.size();
+		while (!m_ids.empty() && m_ids.back() == InvalidId)
+		{
+			m_items.pop_back();
+			m_ids.pop_back();
+			m_updated.pop_back();
+		}
+		if ((int)m_ids.size() != oldSize)
+		{
+			removeUpdatedIndicesFrom((int)m_ids.size());
+		}
+	}
+
+	void removeUpdatedIndicesFrom(int size)
+	{
+		m_updatedIndices.erase(std::remove_if(m_updatedIndices.begin(), m_updatedIndices.end(),
+			[size](int index) { return index >= size; }), m_updatedIndices.end());
+	}
+
+	void markUpdated(int index, UpdateMask mask)
+	{
+		if (m_updated[index] == 0)
+		{
+			m_updatedIndices.emplace_back(index);
+		}
+		m_updated[index] |= mask;
+		m_anyUpdated = true;
+	}
+
+	void freeItem(int index)
+	{
+		m_freeItems.emplace_back(index);
+		m_idMap.reset(m_ids[index]);
+		m_ids[index] = InvalidId;
+		m_count--;
+	}
+
 	Comp m_empty;
 	// Because we don't properly remove items when remove is called, but we mark them as free, so we need
-	// a way to count the items. Another option would be again to use std::unordered_map instead of current idMap.
+	// a way to count the items.
 	int m_count = 0;
 	Array<Comp> m_items; // Size is only the size of required number of components
-	// A map from an Id (which is the index [id]) to a value, which is the index in the m_items.
-	// So to get an item with known Id, we do: m_items[m_idMap[id]].
-	// Size is the required size of Ids, so it will contain all the Ids in the World.
-	// This could be replaced with an std::unordered_map, and then we should measure if it is fast enough.
-	// At least this array map takes a huge amount of wasted space on each table for all the world Ids.
-	Array<int> m_idMap;
+	// The Id of each item in m_items, or InvalidId for the free items. Size is the same as m_items.
+	Array<Id> m_ids;
+	// A map from an Id to the index in the m_items.
+	// So to get an item with known Id, we do: m_items[m_idMap.get(id)].
+	// It is paged, so it doesn't need to contain all the Ids in the World.
+	IdMap m_idMap;
 	Array<int> m_freeItems;
 
 	bool m_anyUpdated = false;
-	Array<bool_t> m_updated; // Size is the same as m_items, so only required number of components.
+	Array<UpdateMask> m_updated; // Size is the same as m_items, so only required number of components.
+	Array<int> m_updatedIndices; // The indices with the m_updated flag set.
 };
 
+// The queries go through the dense items, so they only cost as much as there are items in the table.
+// The iteration order is the order of the items, which is the creation order, unless free items have
+// been re-used.
+
 template <typename Comp>
 void query(Table<Comp>& table, std::function<void(Id, Comp&)> process)
 {
-	for (int i = 0; i < (int)table.m_idMap.size(); ++i)
+	for (int i = 0; i < (int)table.m_ids.size(); ++i)
 	{
-		if (table.m_idMap[i] != InvalidIndex)
+		if (table.m_ids[i] != InvalidId)
 		{
-			process((Id)i, table.modifyF((Id)i));
+			process(table.m_ids[i], table.m_items[i]);
 		}
 	}
 }
@@ -387,11 +609,11 @@ void query(Table<Comp>& table, std::function<void(Id, Comp&)> process)
 template <typename Comp>
 void query(Table<Comp>& table, std::function<void(Id)> process)
 {
-	for (int i = 0; i < (int)table.m_idMap.size(); ++i)
+	for (int i = 0; i < (int)table.m_ids.size(); ++i)
 	{
-		if (table.m_idMap[i] != InvalidIndex)
+		if (table.m_ids[i] != InvalidId)
 		{
-			process((Id)i);
+			process(table.m_ids[i]);
 		}
 	}
 }
@@ -399,11 +621,11 @@ void query(Table<Comp>& table, std::function<void(Id)> process)
 template <typename Comp>
 void query(const Table<Comp>& table, std::function<void(Id, const Comp&)> process)
 {
-	for (int i = 0; i < (int)table.m_idMap.size(); ++i)
+	for (int i = 0; i < (int)table.m_ids.size(); ++i)
 	{
-		if (table.m_idMap[i] != InvalidIndex)
+		if (table.m_ids[i] != InvalidId)
 		{
-			process((Id)i, table.getF((Id)i));
+			process(table.m_ids[i], table.m_items[i]);
 		}
 	}
 }
@@ -411,13 +633,220 @@ void query(const Table<Comp>& table, std::function<void(Id, const Comp&)> proces
 template <typename Comp>
 void query(const Table<Comp>& table, std::function<void(Id)> process)
 {
-	for (int i = 0; i < (int)table.m_idMap.size(); ++i)
+	for (int i = 0; i < (int)table.m_ids.size(); ++i)
+	{
+		if (table.m_ids[i] != InvalidId)
+		{
+			process(table.m_ids[i]);
+		}
+	}
+}
+
+// Template versions of the queries above. These take any callable, so the call can be inlined, which
+// the std::function can't do. They iterate the dense items directly, so prefer these in hot loops.
+// Usage example:
+// queryItems<Transform>(transforms, [&](Id id, const Transform& transform) { ... });
+
+template <typename Comp, typename Func>
+void queryItems(Table<Comp>& table, Func&& process)
+{
+	const Array<Id>& ids = table.denseIds();
+	Array<Comp>& items = table.items();
+	const int itemCount = (int)ids.size();
+	for (int i = 0; i < itemCount; ++i)
+	{
+		if (ids[i] != InvalidId)
+		{
+			process(ids[i], items[i]);
+		}
+	}
+}
+
+template <typename Comp, typename Func>
+void queryItems(const Table<Comp>& table, Func&& process)
+{
+	const Array<Id>& ids = table.denseIds();
+	const Array<Comp>& items = table.items();
+	const int itemCount = (int)ids.size();
+	for (int i = 0; i < itemCount; ++i)
+	{
+		if (ids[i] != InvalidId)
+		{
+			process(ids[i], items[i]);
+		}
+	}
+}
+
+template <typename Comp, typename Func>
+void queryIds(const Table<Comp>& table, Func&& process)
+{
+	const Array<Id>& ids = table.denseIds();
+	const int itemCount = (int)ids.size();
+	for (int i = 0; i < itemCount; ++i)
+	{
+		if (ids[i] != InvalidId)
+		{
+			process(ids[i]);
+		}
+	}
+}
+
+// Goes through the items which have been marked as updated since the last clearUpdated, so the cost
+// depends on the number of changes and not on the size of the table. The order is the order of the updates.
+template <typename Comp, typename Func>
+void queryUpdated(const Table<Comp>& table, Func&& process)
+{
+	const Array<Id>& ids = table.denseIds();
+	const Array<Comp>& items = table.items();
+	const Array<int>& updatedIndices = table.updatedIndices();
+	// Not a range-for, because process is allowed to mark more items as updated.
+	for (int i = 0; i < (int)updatedIndices.size(); ++i)
+	{
+		int index = updatedIndices[i];
+		if (ids[index] != InvalidId)
+		{
+			process(ids[index], items[index]);
+		}
+	}
+}
+
+template <int... Indices>
+struct IndexSequence
+{
+};
+
+template <int N, int... Indices>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, Indices...>
+{
+};
+
+template <int... Indices>
+struct MakeIndexSequence<0, Indices...>
+{
+	using Type = IndexSequence<Indices...>;
+};
+
+template <typename Comp>
+Comp& joinItem(Table<Comp>& table, Id id)
+{
+	return table.modifyF(id);
+}
+
+template <typename Comp>
+const Comp& joinItem(const Table<Comp>& table, Id id)
+{
+	return table.getF(id);
+}
+
+inline bool joinCheck(Id id)
+{
+	return true;
+}
+
+template <typename First, typename... Rest>
+bool joinCheck(Id id, const First& first, const Rest&... rest)
+{
+	return first.check(id) && joinCheck(id, rest...);
+}
+
+template <typename Last>
+const Array<Id>& joinSmallestIds(const Last& last)
+{
+	return last.denseIds();
+}
+
+template <typename First, typename... Rest>
+const Array<Id>& joinSmallestIds(const First& first, const Rest&... rest)
+{
+	const Array<Id>& smallestOfRest = joinSmallestIds(rest...);
+	return first.denseIds().size() <= smallestOfRest.size() ? first.denseIds() : smallestOfRest;
+}
+
+// Calls process, which may return void or bool. Returns false if the query should stop.
+template <typename Func, typename... Args>
+auto joinInvoke(Func& process, Args&&... args)
+	-> typename std::enable_if<std::is_void<decltype(process(std::forward<Args>(args)...))>::value, bool>::type
+{
+	process(std::forward<Args>(args)...);
+	return true;
+}
+
+template <typename Func, typename... Args>
+auto joinInvoke(Func& process, Args&&... args)
+	-> typename std::enable_if<!std::is_void<decltype(process(std::forward<Args>(args)...))>::value, bool>::type
+{
+	return process(std::forward<Args>(args)...);
+}
+
+// A query over multiple tables, which only visits the Ids that have a component in all of them.
+// The table with the smallest dense storage drives the loop, and the others are just checked, so the cost
+// is proportional to the smallest table. Const tables give const references to their components.
+// The process function can return a bool, and returning false will stop the query.
+// Usage example:
+// join(meshLinks, worldTransforms).without(selected).query([&](Id id, const MeshLink& meshLink, const Transform& transform)
+// {
+// });
+template <typename... Tables>
+class Join
+{
+public:
+	Join(Tables&... tables) :
+		m_tables(&tables...)
 	{
-		if (table.m_idMap[i] != InvalidIndex)
+	}
+
+	// Skip the Ids which have a component in the given table.
+	Join& without(const ITable& table)
+	{
+		m_excluded.emplace_back(&table);
+		return *this;
+	}
+
+	template <typename Func>
+	void query(Func&& process)
+	{
+		queryIndices(process, typename MakeIndexSequence<sizeof...(Tables)>::Type());
+	}
+
+protected:
+	template <typename Func, int... Indices>
+	void queryIndices(Func& process, IndexSequence<Indices...>)
+	{
+		const Array<Id>& driverIds = joinSmallestIds(*std::get<Indices>(m_tables)...);
+		const int itemCount = (int)driverIds.size();
+		for (int i = 0; i < itemCount; ++i)
 		{
-			process((Id)i);
+			Id id = driverIds[i];
+			if (id == InvalidId
+				|| !joinCheck(id, *std::get<Indices>(m_tables)...)
+				|| isExcluded(id))
+			{
+				continue;
+			}
+
+			if (!joinInvoke(process, id, joinItem(*std::get<Indices>(m_tables), id)...))
+				return;
 		}
 	}
+
+	bool isExcluded(Id id) const
+	{
+		for (auto&& table : m_excluded)
+		{
+			if (table->contains(id))
+				return true;
+		}
+		return false;
+	}
+
+	std::tuple<Tables*...> m_tables;
+	Array<const ITable*> m_excluded;
+};
+
+template <typename... Tables>
+Join<Tables...> join(Tables&... tables)
+{
+	return Join<Tables...>(tables...);
 }
 
 };
@@ -0,0 +1,389 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae/entity/Table.hpp"
+#include "rae/entity/ParallelQuery.hpp"
+
+#include "loguru/loguru.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace rae;
+
+SCENARIO("Table unittest", "[rae][Table]")
+{
+	GIVEN( "a table with a few sparse ids" )
+	{
+		Table<int> table;
+		table.assign(3, 30);
+		table.assign(100000, 1000000);
+		table.assign(5000, 50000);
+
+		REQUIRE(table.count() == 3);
+		REQUIRE(table.check(3) == true);
+		REQUIRE(table.check(4) == false);
+		REQUIRE(table.check(100000) == true);
+		REQUIRE(table.check(999999) == false);
+		REQUIRE(table.get(5000) == 50000);
+
+		// Only the pages which contain ids are allocated.
+		REQUIRE(table.idMap().allocatedPageCount() == 3);
+
+		WHEN( "an id is removed and another one is assigned" )
+		{
+			table.remove(5000);
+			REQUIRE(table.check(5000) == false);
+			REQUIRE(table.count() == 2);
+			REQUIRE(table.idMap().allocatedPageCount() == 2);
+
+			table.assign(7, 70);
+			THEN( "the free item is re-used" )
+			{
+				REQUIRE(table.items().size() == 3);
+				REQUIRE(table.get(7) == 70);
+				REQUIRE(table.get(100000) == 1000000);
+			}
+		}
+
+		WHEN( "the table is queried" )
+		{
+			table.remove(3);
+
+			int sum = 0;
+			int visited = 0;
+			query<int>(table, [&](Id id, const int& value)
+			{
+				REQUIRE(value == id * 10);
+				sum += value;
+				visited++;
+			});
+
+			REQUIRE(visited == 2);
+			REQUIRE(sum == 1000000 + 50000);
+		}
+
+		WHEN( "the table is defragmented" )
+		{
+			table.remove(3);
+			table.defragment();
+
+			REQUIRE(table.items().size() == 2);
+			REQUIRE(table.get(100000) == 1000000);
+			REQUIRE(table.get(5000) == 50000);
+			REQUIRE(table.check(3) == false);
+		}
+	}
+
+	GIVEN( "a fragmented table which is defragmented incrementally" )
+	{
+		Table<int> table;
+		for (int id = 1; id <= 100; ++id)
+		{
+			table.assign(id, id * 10);
+		}
+		table.clearUpdated();
+		for (int id = 1; id <= 100; id += 3)
+		{
+			table.remove(id);
+		}
+		table.setUpdated(98);
+		table.setUpdated(99);
+
+		int steps = 0;
+		while (table.isFragmented())
+		{
+			int moves = table.defragmentStep(5);
+			REQUIRE(moves <= 5);
+			steps++;
+		}
+
+		THEN( "the table is dense and all the items are still found" )
+		{
+			REQUIRE(steps > 1);
+			REQUIRE(table.items().size() == table.count());
+			REQUIRE(table.count() == 66);
+			for (int id = 1; id <= 100; ++id)
+			{
+				REQUIRE(table.check(id) == (id % 3 != 1));
+				if (table.check(id))
+					REQUIRE(table.get(id) == id * 10);
+			}
+
+			Array<Id> updatedIds;
+			queryUpdated<int>(table, [&](Id id, const int& value)
+			{
+				updatedIds.emplace_back(id);
+			});
+			REQUIRE(updatedIds.size() == 2);
+			REQUIRE(table.isUpdated(98) == true);
+			REQUIRE(table.isUpdated(99) == true);
+
+			table.assign(1000, 1);
+			REQUIRE(table.items().size() == table.count());
+		}
+	}
+
+	GIVEN( "a table queried with the template queries" )
+	{
+		Table<int> table;
+		for (int i = 1; i <= 10; ++i)
+		{
+			table.assign(i * 100, i);
+		}
+		table.remove(500);
+
+		int sum = 0;
+		queryItems<int>(table, [&](Id id, int& value)
+		{
+			value *= 2;
+			sum += value;
+		});
+		REQUIRE(sum == (55 - 5) * 2);
+
+		int idCount = 0;
+		queryIds<int>(table, [&](Id id)
+		{
+			REQUIRE(table.check(id));
+			idCount++;
+		});
+		REQUIRE(idCount == 9);
+	}
+
+	GIVEN( "a table with a few updated items" )
+	{
+		Table<int> table;
+		for (int id = 1; id <= 100; ++id)
+		{
+			table.assign(id, id);
+		}
+		table.clearUpdated();
+		REQUIRE(table.updatedIndices().empty());
+
+		table.setUpdated(30);
+		table.setUpdated(10);
+		table.setUpdated(30);
+		table.setUpdated(20);
+		table.remove(20);
+
+		THEN( "only the updated items are queried, once each, in the order of the updates" )
+		{
+			Array<Id> visited;
+			queryUpdated<int>(table, [&](Id id, const int& value)
+			{
+				visited.emplace_back(id);
+			});
+			REQUIRE(visited.size() == 2);
+			REQUIRE(visited[0] == 30);
+			REQUIRE(visited[1] == 10);
+		}
+
+		WHEN( "the updates are cleared" )
+		{
+			table.clearUpdated();
+			THEN( "no flags are left behind" )
+			{
+				REQUIRE(table.isAnyUpdated() == false);
+				REQUIRE(table.isUpdated(30) == false);
+				REQUIRE(table.isUpdated(10) == false);
+				REQUIRE(table.updatedIndices().empty());
+			}
+		}
+
+		WHEN( "the table is defragmented" )
+		{
+			table.defragment();
+			THEN( "the updated items are still found" )
+			{
+				int count = 0;
+				queryUpdated<int>(table, [&](Id id, const int& value)
+				{
+					REQUIRE(table.isUpdated(id));
+					count++;
+				});
+				REQUIRE(count == 2);
+			}
+		}
+	}
+
+	GIVEN( "three tables joined together" )
+	{
+		Table<int> numbers;
+		Table<float> floats;
+		Table<bool_t> flags;
+
+		for (int id = 1; id <= 100; ++id)
+		{
+			numbers.assign(id, id);
+			if (id % 2 == 0)
+				floats.assign(id, float(id) * 0.5f);
+		}
+		flags.assign(10, true);
+		flags.assign(11, true);
+		flags.assign(20, false);
+
+		WHEN( "the join is queried" )
+		{
+			Array<Id> visited;
+			join(numbers, floats, flags).query([&](Id id, int& number, float& value, bool_t& flag)
+			{
+				REQUIRE(number == id);
+				REQUIRE(value == float(id) * 0.5f);
+				number = 0;
+				visited.emplace_back(id);
+			});
+
+			THEN( "only the ids in all of the tables are visited, and components can be modified" )
+			{
+				REQUIRE(visited.size() == 2);
+				REQUIRE(numbers.get(10) == 0);
+				REQUIRE(numbers.get(20) == 0);
+				REQUIRE(numbers.get(11) == 11);
+			}
+		}
+
+		WHEN( "the join has an exclusion filter" )
+		{
+			Array<Id> visited;
+			const Table<int>& constNumbers = numbers;
+			join(constNumbers, floats).without(flags).query([&](Id id, const int& number, float& value)
+			{
+				visited.emplace_back(id);
+			});
+
+			REQUIRE(visited.size() == 48);
+			REQUIRE(std::find(visited.begin(), visited.end(), 10) == visited.end());
+		}
+
+		WHEN( "the join is stopped early" )
+		{
+			int visitCount = 0;
+			join(numbers).query([&](Id id, int& number) -> bool
+			{
+				visitCount++;
+				return id < 5;
+			});
+
+			REQUIRE(visitCount == 5);
+		}
+	}
+
+	GIVEN( "a big table processed with parallelQuery" )
+	{
+		Table<int> table;
+		for (int id = 1; id <= 10000; ++id)
+		{
+			table.assign(id, id);
+		}
+		table.remove(5000);
+		table.clearUpdated();
+
+		ThreadPool pool(4);
+		DeferredUpdates updates;
+		parallelQuery<int>(table, updates, [&](Id id, int& value, Array<Id>& updatedIds)
+		{
+			value = value * 2;
+			if (id % 10 == 0)
+				updatedIds.emplace_back(id);
+		}, pool);
+
+		REQUIRE(table.isAnyUpdated() == false);
+		updates.apply(table);
+
+		THEN( "every item is processed once and the deferred updates are applied" )
+		{
+			bool allDoubled = true;
+			queryItems<int>(table, [&](Id id, const int& value)
+			{
+				if (value != id * 2)
+					allDoubled = false;
+			});
+			REQUIRE(allDoubled == true);
+			REQUIRE(table.isAnyUpdated() == true);
+			REQUIRE(table.isUpdated(10) == true);
+			REQUIRE(table.isUpdated(11) == false);
+		}
+	}
+}
+
+// Hidden from the default test run. Run with: ./pihlaja "[benchmark]"
+SCENARIO("Table query benchmark", "[.][benchmark][Table]")
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	const int WorldSize = 100000;
+	const int Occupancy = 100; // Every 100th id, so 1% of the world.
+	const int Repeats = 1000;
+
+	Table<vec3> table;
+	for (int id = 1; id < WorldSize; id += Occupancy)
+	{
+		table.assign(id, vec3(float(id), 1.0f, 2.0f));
+	}
+
+	// The previous layout: a world sized idMap, which is walked by query through a std::function.
+	Array<int> worldIdMap(WorldSize, InvalidIndex);
+	for (int i = 0; i < (int)table.denseIds().size(); ++i)
+	{
+		worldIdMap[table.denseIds()[i]] = i;
+	}
+
+	auto measure = [&](const char* name, std::function<float()> run)
+	{
+		auto start = Clock::now();
+		float result = 0.0f;
+		for (int k = 0; k < Repeats; ++k)
+		{
+			result += run();
+		}
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		LOG_F(INFO, "%s: %f ms per query (result %f)", name, ms / Repeats, result);
+		return ms;
+	};
+
+	double worldMs = measure("World sized idMap walk with std::function", [&]() -> float
+	{
+		float sum = 0.0f;
+		std::function<void(Id, const vec3&)> process = [&](Id id, const vec3& value)
+		{
+			sum += value.x;
+		};
+		for (int i = 0; i < (int)worldIdMap.size(); ++i)
+		{
+			if (worldIdMap[i] != InvalidIndex)
+			{
+				process((Id)i, table.items()[worldIdMap[i]]);
+			}
+		}
+		return sum;
+	});
+
+	double queryMs = measure("Dense query with std::function", [&]() -> float
+	{
+		float sum = 0.0f;
+		query<vec3>(table, [&](Id id, vec3& value)
+		{
+			sum += value.x;
+		});
+		return sum;
+	});
+
+	double queryItemsMs = measure("Dense queryItems with a template callable", [&]() -> float
+	{
+		float sum = 0.0f;
+		queryItems<vec3>(table, [&](Id id, const vec3& value)
+		{
+			sum += value.x;
+		});
+		return sum;
+	});
+
+	LOG_F(INFO, "Speedup queryItems vs world walk: %fx, vs std::function query: %fx",
+		worldMs / queryItemsMs, queryMs / queryItemsMs);
+
+	REQUIRE(queryItemsMs < worldMs);
+}
+
+#endif
@@ -199,22 +199,24 @@ void Scene::selectNextEntity()
 		}
 	}
 
-	Id id = firstSelected;
+	// Go through the entity indices in order, starting after the selected one.
+	int index = idIndex(firstSelected);
 	bool running = true;
 	bool reachedEnd = false;
 	while (running)
 	{
-		id = id + 1;
-		if (m_entitySystem.isAlive(id))
+		index = index + 1;
+		Id id = m_entitySystem.entityAtIndex(index);
+		if (id != InvalidId)
 		{
 			m_selectionSystem.setSelected(id, true);
 			running = false;
 			break;
 		}
 
-		if (id >= m_entitySystem.biggestId())
+		if (index >= m_entitySystem.biggestIndex())
 		{
-			id = InvalidId;
+			index = 0;
 			if (reachedEnd)
 			{
 				// Second time of reaching end. Maybe this can't happen. I guess we should run into firstSelected first.
@@ -1,5 +1,6 @@
 #include "rae/scene/Transform.hpp"
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
 
 #include "rae/core/Utils.hpp"
 #include "rae/core/Math.hpp"
@@ -25,6 +26,23 @@ Transform::Transform(vec3 const& position, qua const& rotation, vec3 const& scal
 {
 }
 
+mat4 Transform::toMatrix() const
+{
+	mat4 translationMatrix = glm::translate(mat4(1.0f), position);
+	mat4 rotationMatrix = glm::toMat4(rotation);
+	mat4 scaleMatrix = glm::scale(mat4(1.0f), scale);
+	return translationMatrix * rotationMatrix * scaleMatrix;
+}
+
+mat4 Transform::toInverseMatrix() const
+{
+	// Scale must never be 0.
+	mat4 inverseScaleMatrix = glm::scale(mat4(1.0f), vec3(1.0f) / scale);
+	mat4 inverseRotationMatrix = glm::toMat4(glm::conjugate(rotation));
+	mat4 inverseTranslationMatrix = glm::translate(mat4(1.0f), -position);
+	return inverseScaleMatrix * inverseRotationMatrix * inverseTranslationMatrix;
+}
+
 String Transform::toString() const
 {
 	String ret = "x: ";
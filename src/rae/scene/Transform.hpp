@@ -15,6 +15,11 @@ public:
 	Transform(vec3 const& position, qua const& rotation, vec3 const& scale);
 	String toString() const;
 
+	// The model matrix: translate * rotate * scale.
+	mat4 toMatrix() const;
+	// The inverse of toMatrix, built from the parts, so no general matrix inversion is needed.
+	mat4 toInverseMatrix() const;
+
 	vec3	position		= vec3(0.0f, 0.0f, 0.0f);
 	qua		rotation;
 	vec3	scale			= vec3(1.0f, 1.0f, 1.0f);
@@ -1,5 +1,6 @@
 #include "rae/scene/TransformSystem.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -8,6 +9,7 @@
 #include <glm/gtx/quaternion.hpp>
 
 #include "rae/core/Utils.hpp"
+#include "rae/entity/ParallelQuery.hpp"
 
 using namespace rae;
 
@@ -16,12 +18,20 @@ static const int ReserveBoxes = 1000;
 
 TransformSystem::TransformSystem() :
 	ISystem("TransformSystem"),
-	m_localTransforms(ReserveTransforms),
+	m_localPositions(ReserveTransforms),
+	m_localRotations(ReserveTransforms),
+	m_localScales(ReserveTransforms),
 	m_worldTransforms(ReserveTransforms),
+	m_worldMatrices(ReserveTransforms),
+	m_inverseWorldMatrices(ReserveTransforms),
 	m_boxes(ReserveBoxes)
 {
-	addTable(m_localTransforms);
+	addTable(m_localPositions);
+	addTable(m_localRotations);
+	addTable(m_localScales);
 	addTable(m_worldTransforms);
+	addTable(m_worldMatrices);
+	addTable(m_inverseWorldMatrices);
 
 	addTable(m_parents);
 	addTable(m_childrens);
@@ -34,7 +44,7 @@ TransformSystem::TransformSystem() :
 
 UpdateStatus TransformSystem::update()
 {
-	m_anyTransformUpdated = m_localTransforms.isAnyUpdated() || m_worldTransforms.isAnyUpdated();
+	m_anyTransformUpdated = isAnyLocalTransformUpdated() || m_worldTransforms.isAnyUpdated();
 
 	syncLocalAndWorldTransforms();
 
@@ -63,78 +73,58 @@ void TransformSystem::syncLocalAndWorldTransforms()
 	});
 	*/
 
-	query<Transform>(m_localTransforms, [&](Id id)
+	// Nothing to propagate, and no flags to clear. A static scene doesn't pay for the hierarchy walk.
+	if (!isAnyLocalTransformUpdated() && !m_worldTransforms.isAnyUpdated())
 	{
-		if (!hasParent(id))
+		m_parentChanged.clear();
+		return;
+	}
+
+	if (m_isHierarchyChanged)
+	{
+		rebuildHierarchyOrder();
+	}
+
+	// Find the changed entities in the hierarchy order. Everything below a changed entity needs to be synced,
+	// but nothing else, so the cost depends on the size of the changed subtrees and not on the whole scene.
+	m_changedPositions.clear();
+	auto addChanged = [&](Id id)
+	{
+		int position = m_orderPositions.get(id);
+		if (position != InvalidIndex && m_hierarchyOrder[position] == id)
+			m_changedPositions.emplace_back(position);
+	};
+	queryUpdated<vec3>(m_localPositions, [&](Id id, const vec3&) { addChanged(id); });
+	queryUpdated<qua>(m_localRotations, [&](Id id, const qua&) { addChanged(id); });
+	queryUpdated<vec3>(m_localScales, [&](Id id, const vec3&) { addChanged(id); });
+	queryUpdated<Transform>(m_worldTransforms, [&](Id id, const Transform&) { addChanged(id); });
+	std::sort(m_changedPositions.begin(), m_changedPositions.end());
+
+	// The order is parent before child, and the subtrees are contiguous, so a single pass syncs the parents
+	// before their children. A changed entity inside an already synced subtree is skipped.
+	int syncedEnd = 0;
+	for (int position : m_changedPositions)
+	{
+		if (position < syncedEnd)
+			continue;
+
+		syncedEnd = m_subtreeEnds[position];
+		for (int i = position; i < syncedEnd; ++i)
 		{
-			processHierarchy(id, [this](Id id)
-			{
-				if (hasParent(id))
-				{
-					Id parentId = getParent(id);
-					const auto& parentWorldTransform = getWorldTransform(parentId);
-
-					// RAE_TODO: It is pretty stupid that we have to update pos rot and scale
-					// whenever any of them changes, because we are only tracking the changes on
-					// component level. Possibly consider splitting Transform into three separate
-					// components, even if it makes things painful? Or think about how to separate
-					// the updated flags.
-
-					// Either our local position was set.
-					if (m_localTransforms.isUpdatedF(id))
-					{
-						setWorldPosition(id, parentWorldTransform.position + m_localTransforms.getF(id).position);
-
-						setWorldRotation(id, parentWorldTransform.rotation * m_localTransforms.getF(id).rotation);
-
-						setWorldScale(id, parentWorldTransform.scale * m_localTransforms.getF(id).scale);
-					}
-					// Our world position was set. Must fix local then.
-					else if (m_worldTransforms.isUpdatedF(id))
-					{
-						setLocalPosition(id, m_worldTransforms.getF(id).position - parentWorldTransform.position);
-
-						qua inverseParentRotation = glm::inverse(parentWorldTransform.rotation);
-						setLocalRotation(id, inverseParentRotation * m_worldTransforms.getF(id).rotation);
-
-						// Scale must never be 0: RAE_TODO assert.
-						setLocalScale(id, m_worldTransforms.getF(id).scale / parentWorldTransform.scale);
-					}
-					// Parent world position changed
-					else if (m_worldTransforms.isUpdatedF(parentId))
-					{
-						setWorldPosition(id, parentWorldTransform.position + m_localTransforms.getF(id).position);
-
-						setWorldRotation(id, parentWorldTransform.rotation * m_localTransforms.getF(id).rotation);
-
-						setWorldScale(id, parentWorldTransform.scale * m_localTransforms.getF(id).scale);
-					}
-				}
-				else // no parents. Just make them the same because they should always be equal.
-				{
-					if (m_localTransforms.isUpdatedF(id))
-					{
-						setWorldPosition(id, m_localTransforms.getF(id).position);
-						setWorldRotation(id, m_localTransforms.getF(id).rotation);
-						setWorldScale(id, m_localTransforms.getF(id).scale);
-					}
-					else if (m_worldTransforms.isUpdatedF(id))
-					{
-						setLocalPosition(id, m_worldTransforms.getF(id).position);
-						setLocalRotation(id, m_worldTransforms.getF(id).rotation);
-						setLocalScale(id, m_worldTransforms.getF(id).scale);
-					}
-				}
-			});
+			syncTransform(m_hierarchyOrder[i]);
 		}
-	});
+	}
+
+	updateWorldMatrices();
 
-	m_localTransforms.clearUpdated();
+	m_localPositions.clearUpdated();
+	m_localRotations.clearUpdated();
+	m_localScales.clearUpdated();
 	m_worldTransforms.clearUpdated();
 
 	// Assert check:
 	/*
-	query<Transform>(m_localTransforms, [&](Id id)
+	query<vec3>(m_localPositions, [&](Id id)
 	{
 		if (!hasParent(id))
 		{
@@ -149,11 +139,162 @@ void TransformSystem::syncLocalAndWorldTransforms()
 	m_parentChanged.clear();
 }
 
+// The channels are synced separately, so e.g. moving an entity only touches the positions
+// of it and its children.
+void TransformSystem::syncTransform(Id id)
+{
+	if (hasParent(id))
+	{
+		Id parentId = getParent(id);
+		const auto& parentWorldTransform = getWorldTransform(parentId);
+
+		// Either our local position was set.
+		if (m_localPositions.isUpdatedF(id))
+		{
+			setWorldPosition(id, parentWorldTransform.position + m_localPositions.getF(id));
+		}
+		// Our world position was set. Must fix local then.
+		else if (m_worldTransforms.isUpdatedF(id, PositionChannel))
+		{
+			setLocalPosition(id, m_worldTransforms.getF(id).position - parentWorldTransform.position);
+		}
+		// Parent world position changed
+		else if (m_worldTransforms.isUpdatedF(parentId, PositionChannel))
+		{
+			setWorldPosition(id, parentWorldTransform.position + m_localPositions.getF(id));
+		}
+
+		if (m_localRotations.isUpdatedF(id))
+		{
+			setWorldRotation(id, parentWorldTransform.rotation * m_localRotations.getF(id));
+		}
+		else if (m_worldTransforms.isUpdatedF(id, RotationChannel))
+		{
+			qua inverseParentRotation = glm::inverse(parentWorldTransform.rotation);
+			setLocalRotation(id, inverseParentRotation * m_worldTransforms.getF(id).rotation);
+		}
+		else if (m_worldTransforms.isUpdatedF(parentId, RotationChannel))
+		{
+			setWorldRotation(id, parentWorldTransform.rotation * m_localRotations.getF(id));
+		}
+
+		if (m_localScales.isUpdatedF(id))
+		{
+			setWorldScale(id, parentWorldTransform.scale * m_localScales.getF(id));
+		}
+		else if (m_worldTransforms.isUpdatedF(id, ScaleChannel))
+		{
+			// Scale must never be 0: RAE_TODO assert.
+			setLocalScale(id, m_worldTransforms.getF(id).scale / parentWorldTransform.scale);
+		}
+		else if (m_worldTransforms.isUpdatedF(parentId, ScaleChannel))
+		{
+			setWorldScale(id, parentWorldTransform.scale * m_localScales.getF(id));
+		}
+	}
+	else // no parents. Just make them the same because they should always be equal.
+	{
+		if (m_localPositions.isUpdatedF(id))
+			setWorldPosition(id, m_localPositions.getF(id));
+		else if (m_worldTransforms.isUpdatedF(id, PositionChannel))
+			setLocalPosition(id, m_worldTransforms.getF(id).position);
+
+		if (m_localRotations.isUpdatedF(id))
+			setWorldRotation(id, m_localRotations.getF(id));
+		else if (m_worldTransforms.isUpdatedF(id, RotationChannel))
+			setLocalRotation(id, m_worldTransforms.getF(id).rotation);
+
+		if (m_localScales.isUpdatedF(id))
+			setWorldScale(id, m_localScales.getF(id));
+		else if (m_worldTransforms.isUpdatedF(id, ScaleChannel))
+			setLocalScale(id, m_worldTransforms.getF(id).scale);
+	}
+}
+
+void TransformSystem::updateWorldMatrices()
+{
+	queryUpdated<Transform>(m_worldTransforms, [&](Id id, const Transform& transform)
+	{
+		m_worldMatrices.assign(id, transform.toMatrix());
+		m_inverseWorldMatrices.assign(id, transform.toInverseMatrix());
+	});
+}
+
+void TransformSystem::rebuildHierarchyOrder()
+{
+	m_hierarchyOrder.clear();
+	m_subtreeEnds.clear();
+	m_orderPositions.clear();
+
+	Array<int> parentPositions;
+	parentPositions.reserve(m_localPositions.size());
+
+	// Depth first, with a stack instead of recursion. Each entry is the Id and the position of its parent.
+	Array<std::pair<Id, int>> stack;
+	queryIds<vec3>(m_localPositions, [&](Id rootId)
+	{
+		if (hasParent(rootId))
+			return;
+
+		stack.emplace_back(rootId, -1);
+		while (!stack.empty())
+		{
+			Id id = stack.back().first;
+			int parentPosition = stack.back().second;
+			stack.pop_back();
+
+			int position = (int)m_hierarchyOrder.size();
+			m_orderPositions.set(id, position);
+			m_hierarchyOrder.emplace_back(id);
+			parentPositions.emplace_back(parentPosition);
+
+			if (hasChildren(id))
+			{
+				const auto& children = getChildren(id);
+				// Reversed, so that the children come out of the stack in their own order.
+				for (auto it = children.rbegin(); it != children.rend(); ++it)
+				{
+					// Children without a transform, e.g. already removed ones, can't be synced.
+					if (m_localPositions.check(*it))
+						stack.emplace_back(*it, position);
+				}
+			}
+		}
+	});
+
+	// The subtree of an entity is the range from it to the end of its last descendant.
+	const int count = (int)m_hierarchyOrder.size();
+	m_subtreeEnds.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		m_subtreeEnds[i] = i + 1;
+	}
+	for (int i = count - 1; i >= 0; --i)
+	{
+		int parentPosition = parentPositions[i];
+		if (parentPosition != -1)
+			m_subtreeEnds[parentPosition] = std::max(m_subtreeEnds[parentPosition], m_subtreeEnds[i]);
+	}
+
+	m_isHierarchyChanged = false;
+}
+
+void TransformSystem::destroyEntities(const Array<Id>& entities)
+{
+	ISystem::destroyEntities(entities);
+	m_isHierarchyChanged = true;
+}
+
+bool TransformSystem::isAnyLocalTransformUpdated() const
+{
+	return m_localPositions.isAnyUpdated() || m_localRotations.isAnyUpdated() || m_localScales.isAnyUpdated();
+}
+
 bool TransformSystem::hasAnyTransformChanged() const
 {
 	//RAE_TODO: Think about updates again. This is no longer up-to-date because of the
 	// local -> world syncing, which uses updated too.
-	//return m_localTransforms.isAnyUpdated();
+	//return isAnyLocalTransformUpdated();
 	return m_anyTransformUpdated;
 }
 
@@ -234,56 +375,64 @@ void TransformSystem::processSiblingsExclusive(Id id, std::function<void(Id)> pr
 
 void TransformSystem::addTransform(Id id, const Transform& transform)
 {
-	m_localTransforms.assign(id, transform);
+	m_localPositions.assign(id, transform.position);
+	m_localRotations.assign(id, transform.rotation);
+	m_localScales.assign(id, transform.scale);
 	m_worldTransforms.assign(id, transform);
+	m_isHierarchyChanged = true;
 }
 
 bool TransformSystem::hasLocalTransform(Id id) const
 {
-	return m_localTransforms.check(id);
+	return m_localPositions.check(id);
 }
 
-const Transform& TransformSystem::getLocalTransform(Id id) const
+Transform TransformSystem::getLocalTransform(Id id) const
 {
-	return m_localTransforms.get(id);
-}
-
-Transform& TransformSystem::modifyLocalTransform(Id id)
-{
-	return m_localTransforms.modifyF(id);
+	return Transform(m_localPositions.get(id), m_localRotations.get(id), m_localScales.get(id));
 }
 
 void TransformSystem::setLocalPosition(Id id, const vec3& position)
 {
-	m_localTransforms.modifyF(id).position = position;
-	m_localTransforms.setUpdatedF(id);
+	m_localPositions.modifyF(id) = position;
+	m_localPositions.setUpdatedF(id);
 }
 
 const vec3& TransformSystem::getLocalPosition(Id id)
 {
-	return m_localTransforms.getF(id).position;
+	return m_localPositions.getF(id);
 }
 
 void TransformSystem::setLocalRotation(Id id, const qua& rotation)
 {
-	m_localTransforms.modifyF(id).rotation = rotation;
-	m_localTransforms.setUpdatedF(id);
+	m_localRotations.modifyF(id) = rotation;
+	m_localRotations.setUpdatedF(id);
 }
 
 const qua& TransformSystem::getLocalRotation(Id id)
 {
-	return m_localTransforms.getF(id).rotation;
+	return m_localRotations.getF(id);
 }
 
 void TransformSystem::setLocalScale(Id id, const vec3& scale)
 {
-	m_localTransforms.modifyF(id).scale = scale;
-	m_localTransforms.setUpdatedF(id);
+	m_localScales.modifyF(id) = scale;
+	m_localScales.setUpdatedF(id);
 }
 
 const vec3& TransformSystem::getLocalScale(Id id)
 {
-	return m_localTransforms.getF(id).scale;
+	return m_localScales.getF(id);
+}
+
+void TransformSystem::setLocalPositionDeferred(Id id, const vec3& position)
+{
+	m_localPositions.modifyF(id) = position;
+}
+
+void TransformSystem::setLocalPositionsUpdated(const DeferredUpdates& updates)
+{
+	updates.apply(m_localPositions);
 }
 
 bool TransformSystem::hasWorldTransform(Id id) const
@@ -296,6 +445,21 @@ const Transform& TransformSystem::getWorldTransform(Id id) const
 	return m_worldTransforms.getF(id);
 }
 
+bool TransformSystem::hasWorldMatrix(Id id) const
+{
+	return m_worldMatrices.check(id);
+}
+
+const mat4& TransformSystem::getWorldMatrix(Id id) const
+{
+	return m_worldMatrices.getF(id);
+}
+
+const mat4& TransformSystem::getInverseWorldMatrix(Id id) const
+{
+	return m_inverseWorldMatrices.getF(id);
+}
+
 Transform& TransformSystem::modifyWorldTransform(Id id)
 {
 	return m_worldTransforms.modifyF(id);
@@ -304,7 +468,7 @@ Transform& TransformSystem::modifyWorldTransform(Id id)
 void TransformSystem::setWorldPosition(Id id, const vec3& position)
 {
 	m_worldTransforms.modifyF(id).position = position;
-	m_worldTransforms.setUpdatedF(id);
+	m_worldTransforms.setUpdatedF(id, PositionChannel);
 }
 
 const vec3& TransformSystem::getWorldPosition(Id id)
@@ -315,7 +479,7 @@ const vec3& TransformSystem::getWorldPosition(Id id)
 void TransformSystem::setWorldRotation(Id id, const qua& rotation)
 {
 	m_worldTransforms.modifyF(id).rotation = rotation;
-	m_worldTransforms.setUpdatedF(id);
+	m_worldTransforms.setUpdatedF(id, RotationChannel);
 }
 
 const qua& TransformSystem::getWorldRotation(Id id)
@@ -326,7 +490,7 @@ const qua& TransformSystem::getWorldRotation(Id id)
 void TransformSystem::setWorldScale(Id id, const vec3& scale)
 {
 	m_worldTransforms.modifyF(id).scale = scale;
-	m_worldTransforms.setUpdatedF(id);
+	m_worldTransforms.setUpdatedF(id, ScaleChannel);
 }
 
 const vec3& TransformSystem::getWorldScale(Id id)
@@ -365,8 +529,8 @@ Array<Id> TransformSystem::entitiesForTransform(const Array<Id>& ids) const
 void TransformSystem::translate(Id id, const vec3& delta)
 {
 	// Note: doesn't check if Id exists. Will crash/cause stuff if used unwisely.
-	m_localTransforms.modifyF(id).position += delta;
-	m_localTransforms.setUpdatedF(id);
+	m_localPositions.modifyF(id) += delta;
+	m_localPositions.setUpdatedF(id);
 }
 
 void TransformSystem::translate(const Array<Id>& ids, const vec3& delta)
@@ -375,8 +539,8 @@ void TransformSystem::translate(const Array<Id>& ids, const vec3& delta)
 
 	for (auto&& id : topLevelIds)
 	{
-		m_localTransforms.modifyF(id).position += delta;
-		m_localTransforms.setUpdatedF(id);
+		m_localPositions.modifyF(id) += delta;
+		m_localPositions.setUpdatedF(id);
 
 		/* // It is not necessary to move the children, as that is handled in update().
 		if (hasChildren(id))
@@ -394,9 +558,9 @@ void TransformSystem::translate(const Array<Id>& ids, const vec3& delta)
 void TransformSystem::rotate(Id id, const qua& delta)
 {
 	// Note: doesn't check if Id exists. Will crash/cause stuff if used unwisely.
-	qua& rotation = m_localTransforms.modifyF(id).rotation;
+	qua& rotation = m_localRotations.modifyF(id);
 	rotation = rotation * delta;
-	m_localTransforms.setUpdatedF(id);
+	m_localRotations.setUpdatedF(id);
 }
 
 void TransformSystem::rotate(const Array<Id>& ids, const qua& delta)
@@ -405,9 +569,9 @@ void TransformSystem::rotate(const Array<Id>& ids, const qua& delta)
 
 	for (auto&& id : topLevelIds)
 	{
-		qua& rotation = m_localTransforms.modifyF(id).rotation;
+		qua& rotation = m_localRotations.modifyF(id);
 		rotation = rotation * delta;
-		m_localTransforms.setUpdatedF(id);
+		m_localRotations.setUpdatedF(id);
 
 		// It is not necessary to rotate the children, as that is handled in update()?
 	}
@@ -423,7 +587,7 @@ void TransformSystem::rotateAround(const Array<Id>& ids, const qua& delta, const
 		vec3 transformedVector = delta * (position - pivot);
 		position = pivot + transformedVector;
 		rotation = glm::normalize(delta * rotation);
-		m_worldTransforms.setUpdatedF(id);
+		m_worldTransforms.setUpdatedF(id, PositionChannel | RotationChannel);
 	}
 }
 
@@ -454,6 +618,7 @@ void TransformSystem::addChild(Id parent, Id child)
 
 	m_childrenChanged.assign(parent, Changed());
 	m_parentChanged.assign(child, Changed());
+	m_isHierarchyChanged = true;
 }
 
 void TransformSystem::setParent(Id child, Id parent)
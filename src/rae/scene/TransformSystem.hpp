@@ -31,16 +31,26 @@ struct Sphere
 {
 };
 
+class DeferredUpdates;
+
+// The channels of the updated flags of the world transforms. The local transforms are stored in a separate
+// table for each channel, so their updated flags are per channel already.
+const UpdateMask PositionChannel = 1 << 0;
+const UpdateMask RotationChannel = 1 << 1;
+const UpdateMask ScaleChannel = 1 << 2;
+
 class TransformSystem : public ISystem
 {
 public:
 	TransformSystem();
 
 	UpdateStatus update() override;
+	void destroyEntities(const Array<Id>& entities) override;
 
 	void syncLocalAndWorldTransforms();
 
 	bool hasAnyTransformChanged() const;
+	bool isAnyLocalTransformUpdated() const;
 
 	// Process the while hierarchy including the parentId itself.
 	void processHierarchy(Id parentId, std::function<void(Id)> process);
@@ -57,7 +67,8 @@ public:
 	void addTransform(Id id, const Transform& transform);
 
 	bool hasLocalTransform(Id id) const;
-	const Transform& getLocalTransform(Id id) const;
+	// The local transform is stored in columns, so this gathers a copy of it.
+	Transform getLocalTransform(Id id) const;
 
 	void setLocalPosition(Id id, const vec3& position);
 	const vec3& getLocalPosition(Id id);
@@ -66,6 +77,11 @@ public:
 	void setLocalScale(Id id, const vec3& scale);
 	const vec3& getLocalScale(Id id);
 
+	// For parallel queries. Sets the local position without setting the updated flag, because that is not
+	// thread safe. The Ids must be collected and the flags set afterwards with setLocalPositionsUpdated.
+	void setLocalPositionDeferred(Id id, const vec3& position);
+	void setLocalPositionsUpdated(const DeferredUpdates& updates);
+
 	bool hasWorldTransform(Id id) const;
 	const Transform& getWorldTransform(Id id) const;
 
@@ -76,10 +92,21 @@ public:
 	void setWorldScale(Id id, const vec3& scale);
 	const vec3& getWorldScale(Id id);
 
-	int transformCount() const { return m_localTransforms.size(); }
-	const Table<Transform>& localTransforms() const { return m_localTransforms; }
+	int transformCount() const { return m_localPositions.size(); }
+	const Table<vec3>& localPositions() const { return m_localPositions; }
+	const Table<qua>& localRotations() const { return m_localRotations; }
+	const Table<vec3>& localScales() const { return m_localScales; }
+	// The updated flags of the world transforms are set per channel: PositionChannel etc.
 	const Table<Transform>& worldTransforms() const { return m_worldTransforms; }
 
+	// The matrices of the world transforms. They are updated in syncLocalAndWorldTransforms, only for the
+	// entities whose world transform changed, so a world transform set after the sync is not seen here yet.
+	const Table<mat4>& worldMatrices() const { return m_worldMatrices; }
+	const Table<mat4>& inverseWorldMatrices() const { return m_inverseWorldMatrices; }
+	bool hasWorldMatrix(Id id) const;
+	const mat4& getWorldMatrix(Id id) const;
+	const mat4& getInverseWorldMatrix(Id id) const;
+
 	// Get only the toplevel ids. So if there's parent child relationships, then only return the parents.
 	Array<Id> entitiesForTransform(const Array<Id>& ids) const;
 
@@ -139,15 +166,32 @@ public:
 
 private:
 
-	Transform& modifyLocalTransform(Id id);
 	Transform& modifyWorldTransform(Id id);
 
-	// Local transforms. Relative to parents.
-	Table<Transform>	m_localTransforms;
+	void syncTransform(Id id);
+	void updateWorldMatrices();
+	void rebuildHierarchyOrder();
+
+	// Local transforms. Relative to parents. Stored as separate columns, because usually only one of them
+	// changes, e.g. when moving things around, and then the others don't need to be touched at all.
+	Table<vec3>			m_localPositions;
+	Table<qua>			m_localRotations;
+	Table<vec3>			m_localScales;
 	// World transform. The final coordinates to draw and hittest with.
 	Table<Transform>	m_worldTransforms;
+	// Cached from the world transforms, so that the renderers and the ray tracer don't need to build them.
+	Table<mat4>			m_worldMatrices;
+	Table<mat4>			m_inverseWorldMatrices;
 	bool				m_anyTransformUpdated = true;
 
+	// All the entities with a transform in depth first order, so parents come before their children.
+	// Rebuilt when the hierarchy changes, and used to sync only the changed subtrees.
+	Array<Id>			m_hierarchyOrder;
+	Array<int>			m_subtreeEnds; // For each position in the order, one past the last descendant.
+	IdMap				m_orderPositions; // Id to position in m_hierarchyOrder.
+	Array<int>			m_changedPositions; // Temporary for the sync.
+	bool				m_isHierarchyChanged = true;
+
 	Table<Parent>		m_parents;
 	Table<Changed>		m_parentChanged; // These are most likely not used properly. Also see Changed tag inside Table class.
 
@@ -0,0 +1,101 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae/scene/TransformSystem.hpp"
+
+using namespace rae;
+
+SCENARIO("TransformSystem unittest", "[rae][TransformSystem]")
+{
+	GIVEN( "a parent with a child" )
+	{
+		TransformSystem transformSystem;
+		const Id parentId = 2;
+		const Id childId = 3;
+		transformSystem.addTransform(parentId, Transform(vec3(1.0f, 0.0f, 0.0f),
+			glm::angleAxis(0.5f, vec3(0.0f, 1.0f, 0.0f)), vec3(2.0f, 2.0f, 2.0f)));
+		transformSystem.addTransform(childId, Transform(vec3(0.0f, 1.0f, 0.0f)));
+		transformSystem.addChild(parentId, childId);
+		transformSystem.update();
+		transformSystem.onFrameEnd();
+
+		REQUIRE(transformSystem.getWorldPosition(childId) == vec3(1.0f, 1.0f, 0.0f));
+
+		WHEN( "the parent is moved" )
+		{
+			transformSystem.setLocalPosition(parentId, vec3(5.0f, 0.0f, 0.0f));
+			transformSystem.update();
+
+			THEN( "only the position channel is propagated to the child" )
+			{
+				REQUIRE(transformSystem.getWorldPosition(childId) == vec3(5.0f, 1.0f, 0.0f));
+				REQUIRE(transformSystem.worldTransforms().isUpdated(childId, PositionChannel) == false); // Cleared by the sync.
+				REQUIRE(transformSystem.hasAnyTransformChanged() == true);
+			}
+
+			THEN( "the cached matrices are updated" )
+			{
+				const mat4& matrix = transformSystem.getWorldMatrix(childId);
+				REQUIRE(vec3(matrix[3]) == vec3(5.0f, 1.0f, 0.0f));
+
+				mat4 identity = matrix * transformSystem.getInverseWorldMatrix(childId);
+				for (int i = 0; i < 4; ++i)
+				{
+					for (int j = 0; j < 4; ++j)
+					{
+						REQUIRE(identity[i][j] == Approx(i == j ? 1.0f : 0.0f));
+					}
+				}
+			}
+		}
+
+		WHEN( "the world position of the child is set" )
+		{
+			transformSystem.setWorldPosition(childId, vec3(3.0f, 3.0f, 0.0f));
+			REQUIRE(transformSystem.worldTransforms().isUpdated(childId, PositionChannel) == true);
+			REQUIRE(transformSystem.worldTransforms().isUpdated(childId, RotationChannel) == false);
+			transformSystem.update();
+
+			THEN( "the local position is fixed, and the rest of the transform is untouched" )
+			{
+				REQUIRE(transformSystem.getLocalPosition(childId) == vec3(2.0f, 3.0f, 0.0f));
+				REQUIRE(transformSystem.getLocalScale(childId) == vec3(1.0f, 1.0f, 1.0f));
+			}
+		}
+
+		WHEN( "a grandchild is added under the child and the child is moved" )
+		{
+			const Id grandchildId = 4;
+			const Id otherRootId = 5;
+			transformSystem.addTransform(grandchildId, Transform(vec3(0.0f, 0.0f, 1.0f)));
+			transformSystem.addTransform(otherRootId, Transform(vec3(7.0f, 0.0f, 0.0f)));
+			transformSystem.addChild(childId, grandchildId);
+			transformSystem.update();
+			transformSystem.onFrameEnd();
+
+			transformSystem.translate(childId, vec3(0.0f, 2.0f, 0.0f));
+			transformSystem.update();
+
+			THEN( "the changed subtree is synced, and the rest is not touched" )
+			{
+				REQUIRE(transformSystem.getWorldPosition(grandchildId) == vec3(1.0f, 3.0f, 1.0f));
+				REQUIRE(transformSystem.getWorldPosition(parentId) == vec3(1.0f, 0.0f, 0.0f));
+				REQUIRE(transformSystem.getWorldPosition(otherRootId) == vec3(7.0f, 0.0f, 0.0f));
+			}
+		}
+
+		WHEN( "nothing changes" )
+		{
+			transformSystem.update();
+
+			THEN( "nothing is reported as changed" )
+			{
+				REQUIRE(transformSystem.hasAnyTransformChanged() == false);
+			}
+		}
+	}
+}
+
+#endif
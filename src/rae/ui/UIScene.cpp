@@ -664,7 +664,7 @@ void UIScene::render2D(NVGcontext* nanoVG, const AssetSystem& assetSystem)
 	if (m_debugSystem.isEnabled())
 	{
 		// Debug rendering border for WindowEntities.
-		query<WindowEntity>(m_windows, [&](Id id)
+		queryIds<WindowEntity>(m_windows, [&](Id id)
 		{
 			if (m_transformSystem.hasWorldTransform(id) and
 				m_transformSystem.hasBox(id))
@@ -686,7 +686,7 @@ void UIScene::render2D(NVGcontext* nanoVG, const AssetSystem& assetSystem)
 			}
 		});
 
-		query<Keyline>(m_keylines, [&](Id id, const Keyline& keyline)
+		queryItems<Keyline>(m_keylines, [&](Id id, const Keyline& keyline)
 		{
 			float fromX = m_screenSystem.mmToPixels(
 				m_transformSystem.getBox(
@@ -699,7 +699,7 @@ void UIScene::render2D(NVGcontext* nanoVG, const AssetSystem& assetSystem)
 		});
 
 		// Debug position visualization
-		query<Transform>(m_transformSystem.worldTransforms(), [&](Id id, const Transform& transform)
+		queryItems<Transform>(m_transformSystem.worldTransforms(), [&](Id id, const Transform& transform)
 		{
 			float diameter = 1.0f;
 			renderCircle(transform, diameter, Colors::cyan);
@@ -729,7 +729,7 @@ void UIScene::render2D(NVGcontext* nanoVG, const AssetSystem& assetSystem)
 		}
 
 		// Debug hover visualization
-		query<Hover>(m_selectionSystem.hovers(), [&](Id id)
+		queryIds<Hover>(m_selectionSystem.hovers(), [&](Id id)
 		{
 			if (m_transformSystem.hasWorldTransform(id) &&
 				m_transformSystem.hasBox(id))
@@ -1,4 +1,5 @@
 #define GLM_FORCE_RADIANS
+#include <cmath>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -8,6 +9,7 @@
 
 #include "rae/core/Random.hpp"
 #include "rae/visual/Camera.hpp"
+#include "rae/visual/Box.hpp"
 
 using namespace rae;
 
@@ -21,6 +23,29 @@ vec3 rae::randomInUnitDisk()
 	return point;
 }
 
+// Shirley and Chiu, "A Low Distortion Map Between Disk and Square"
+vec3 rae::sampleUnitDisk(const vec2& sample)
+{
+	float a = 2.0f * sample.x - 1.0f;
+	float b = 2.0f * sample.y - 1.0f;
+	if (a == 0.0f && b == 0.0f)
+		return vec3(0.0f, 0.0f, 0.0f);
+
+	float radius;
+	float angle;
+	if (std::abs(a) > std::abs(b))
+	{
+		radius = a;
+		angle = (Math::Pi / 4.0f) * (b / a);
+	}
+	else
+	{
+		radius = b;
+		angle = (Math::Pi / 2.0f) - (Math::Pi / 4.0f) * (a / b);
+	}
+	return vec3(radius * std::cos(angle), radius * std::sin(angle), 0.0f);
+}
+
 Camera::Camera()
 {
 	m_fieldOfView = Math::toRadians(20.0f);
@@ -51,6 +76,13 @@ Ray Camera::getRay(float s, float t) const
 	return Ray(m_position + offset, m_topLeftCorner + (s * m_horizontal) - (t * m_vertical) - m_position - offset);
 }
 
+Ray Camera::getRay(float s, float t, const vec2& lensSample) const
+{
+	vec3 rd = m_lensRadius * sampleUnitDisk(lensSample);
+	vec3 offset = m_right * rd.x + m_up * rd.y;
+	return Ray(m_position + offset, m_topLeftCorner + (s * m_horizontal) - (t * m_vertical) - m_position - offset);
+}
+
 Ray Camera::getExactRay(float s, float t) const
 {
 	//return Ray(origin, lowerLeftCorner + (s * m_horizontal) + (t * m_vertical) - origin);
@@ -59,6 +91,60 @@ Ray Camera::getExactRay(float s, float t) const
 	return Ray(m_position, m_topLeftCorner + (s * m_horizontal) - (t * m_vertical) - m_position);
 }
 
+bool Camera::projectToScreen(const vec3& point, vec2& outScreen) const
+{
+	// The ray of getExactRay reaches the point at some distance k along it:
+	// point - m_position = k * (m_topLeftCorner - m_position) + k * s * m_horizontal - k * t * m_vertical
+	mat3 basis(m_horizontal, -m_vertical, m_topLeftCorner - m_position);
+	vec3 coefficients = glm::inverse(basis) * (point - m_position);
+	if (coefficients.z <= 0.0f)
+		return false;
+
+	outScreen.x = coefficients.x / coefficients.z;
+	outScreen.y = coefficients.y / coefficients.z;
+	return true;
+}
+
+bool Camera::isInView(const Box& box) const
+{
+	const vec3 topRight = m_topLeftCorner + m_horizontal;
+	const vec3 bottomLeft = m_topLeftCorner - m_vertical;
+	const vec3 bottomRight = bottomLeft + m_horizontal;
+	const vec3 corners[5] = { m_topLeftCorner, topRight, bottomRight, bottomLeft, m_topLeftCorner };
+
+	// The four sides of the view through the camera position, and the plane of the camera itself.
+	vec3 normals[5];
+	for (int i = 0; i < 4; ++i)
+	{
+		normals[i] = glm::normalize(glm::cross(corners[i] - m_position, corners[i + 1] - m_position));
+		if (glm::dot(normals[i], m_direction) < 0.0f)
+			normals[i] = -normals[i];
+	}
+	normals[4] = m_direction;
+
+	for (const vec3& normal : normals)
+	{
+		// The corner of the box which is furthest inside. If even that is outside, the whole box is.
+		vec3 inside = vec3(
+			normal.x >= 0.0f ? box.max().x : box.min().x,
+			normal.y >= 0.0f ? box.max().y : box.min().y,
+			normal.z >= 0.0f ? box.max().z : box.min().z);
+		if (glm::dot(normal, inside - m_position) < -m_lensRadius)
+			return false;
+	}
+	return true;
+}
+
+bool Camera::hasSameView(const Camera& other) const
+{
+	return m_position == other.m_position
+		&& m_yawAngle == other.m_yawAngle
+		&& m_pitchAngle == other.m_pitchAngle
+		&& m_coordinatesUp == other.m_coordinatesUp
+		&& m_fieldOfView == other.m_fieldOfView
+		&& m_aspectRatio == other.m_aspectRatio;
+}
+
 void Camera::calculateFrustum()
 {
 	m_lensRadius = m_aperture / 2.0f;
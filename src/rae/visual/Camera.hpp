@@ -12,6 +12,8 @@ namespace rae
 {
 
 vec3 randomInUnitDisk();
+// Maps a uniform sample in [0, 1)^2 to a point in the unit disk, keeping the stratification of the samples.
+vec3 sampleUnitDisk(const vec2& sample);
 
 const float MinFocusDistance = 0.01f;
 
@@ -22,6 +24,8 @@ enum class CoordinatesUp
 	Z // The default!
 };
 
+class Box;
+
 class Camera
 {
 public:
@@ -31,7 +35,18 @@ public:
 	// s and t are from 0.0f to 1.0f, s being x, and t being y coordinate.
 	// Top left corner is 0.0f, 0.0f and center 0.5f, 0.5f.
 	Ray getRay(float s, float t) const;
+	// The lensSample is a uniform sample in [0, 1)^2 for the point on the lens.
+	Ray getRay(float s, float t, const vec2& lensSample) const;
 	Ray getExactRay(float s, float t) const;
+	// The inverse of getExactRay: the s and t of the ray which goes through the point. Returns false for
+	// the points behind the camera. The s and t are outside of 0.0f to 1.0f for the points outside of the view.
+	bool projectToScreen(const vec3& point, vec2& outScreen) const;
+	// False if the box is surely outside of the view. The test is conservative: boxes near the corners of the view
+	// can be reported as visible, and the lens is taken into account.
+	bool isInView(const Box& box) const;
+	// True if the other camera is at the same place, looks the same way and zooms the same. The focus distance and
+	// the aperture can differ, so the same surfaces are seen, only with a different depth of field blur.
+	bool hasSameView(const Camera& other) const;
 
 	void calculateFrustum();
 
@@ -0,0 +1,63 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae/visual/Camera.hpp"
+#include "rae/visual/Box.hpp"
+
+using namespace rae;
+
+SCENARIO("Camera view unittest", "[rae][Camera]")
+{
+	GIVEN( "a camera at the origin looking along the x axis" )
+	{
+		Camera camera(Math::toRadians(45.0f), 16.0f / 9.0f, 0.0f, 10.0f);
+		camera.setPosition(vec3(0.0f, 0.0f, 0.0f));
+		camera.calculateFrustum();
+
+		auto boxAt = [](const vec3& position)
+		{
+			return Box(position - vec3(0.5f), position + vec3(0.5f));
+		};
+
+		THEN( "the boxes in front of it are in view" )
+		{
+			REQUIRE( camera.isInView(boxAt(vec3(10.0f, 0.0f, 0.0f))) );
+			REQUIRE( camera.isInView(boxAt(vec3(100.0f, 20.0f, -10.0f))) );
+			// Partly in view, on the edge of the view.
+			REQUIRE( camera.isInView(boxAt(vec3(10.0f, 7.6f, 0.0f))) );
+		}
+
+		THEN( "the boxes behind it or to the sides are not" )
+		{
+			REQUIRE_FALSE( camera.isInView(boxAt(vec3(-10.0f, 0.0f, 0.0f))) );
+			REQUIRE_FALSE( camera.isInView(boxAt(vec3(10.0f, 20.0f, 0.0f))) );
+			REQUIRE_FALSE( camera.isInView(boxAt(vec3(10.0f, 0.0f, -10.0f))) );
+		}
+
+		THEN( "a box around the camera is in view" )
+		{
+			REQUIRE( camera.isInView(Box(vec3(-1.0f), vec3(1.0f))) );
+		}
+
+		THEN( "changing the focus or the aperture keeps the view, and moving or turning doesn't" )
+		{
+			Camera focused = camera;
+			focused.setFocusDistance(3.0f);
+			focused.setAperture(0.2f);
+			focused.calculateFrustum();
+			REQUIRE( focused.hasSameView(camera) );
+
+			Camera moved = camera;
+			moved.setPosition(vec3(1.0f, 0.0f, 0.0f));
+			REQUIRE_FALSE( moved.hasSameView(camera) );
+
+			Camera turned = camera;
+			turned.setYaw(0.5f);
+			REQUIRE_FALSE( turned.hasSameView(camera) );
+		}
+	}
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include <cmath>
 #include <cassert>
 
+#include "rae/core/Math.hpp"
 #include "rae/core/Random.hpp"
 
 #include "rae/visual/Material.hpp" // includes glew.h which is needed by nanovg headers.
@@ -12,14 +13,23 @@
 using namespace rae;
 
 // TODO move to RayTracerUtils.hpp
-vec3 randomInUnitSphere()
+// Maps a uniform sample in [0, 1)^3 to a uniformly distributed point in the unit sphere.
+vec3 sampleUnitSphere(const vec3& sample)
 {
-	vec3 p;
-	do
-	{
-		p = 2.0f * vec3(getRandom(), getRandom(), getRandom()) - vec3(1,1,1);
-	} while (glm::dot(p,p) >= 1.0f);
-	return p;
+	float z = 1.0f - 2.0f * sample.x;
+	float radiusXY = std::sqrt(std::max(0.0f, 1.0f - z * z));
+	float angle = Math::Tau * sample.y;
+	float radius = std::cbrt(sample.z);
+	return radius * vec3(radiusXY * std::cos(angle), radiusXY * std::sin(angle), z);
+}
+
+// Maps a uniform sample in [0, 1)^2 to a uniformly distributed point on the unit sphere.
+vec3 sampleUnitSphereSurface(const vec2& sample)
+{
+	float z = 1.0f - 2.0f * sample.x;
+	float radiusXY = std::sqrt(std::max(0.0f, 1.0f - z * z));
+	float angle = Math::Tau * sample.y;
+	return vec3(radiusXY * std::cos(angle), radiusXY * std::sin(angle), z);
 }
 
 vec3 reflect(const vec3& v, const vec3& normal)
@@ -48,20 +58,29 @@ float schlick(float cosine, float refractive_index)
 }
 
 bool Material::scatter(const Ray& r_in, const HitRecord& record, vec3& attenuation, Ray& scattered) const
+{
+	return scatter(r_in, record, vec3(getRandom(), getRandom(), getRandom()), attenuation, scattered);
+}
+
+bool Material::scatter(const Ray& r_in, const HitRecord& record, const vec3& sample, vec3& attenuation, Ray& scattered) const
 {
 	switch(m_materialType)
 	{
 		case MaterialType::Lambertian:
 		{
-			vec3 target = record.point + record.normal + randomInUnitSphere();
-			scattered = Ray(record.point, target - record.point);
+			// The normal plus a point on the unit sphere is cosine distributed, so the attenuation is just
+			// the albedo. (A point inside the sphere, like before, isn't quite, and has no simple pdf.)
+			vec3 direction = record.normal + sampleUnitSphereSurface(vec2(sample.x, sample.y));
+			if (glm::dot(direction, direction) < 1e-8f)
+				direction = record.normal;
+			scattered = Ray(record.point, glm::normalize(direction));
 			attenuation = Color3(m_color);
 			return true;
 		}
 		case MaterialType::Metal:
 		{
 			vec3 reflected = reflect( glm::normalize(r_in.direction()), record.normal );
-			scattered = Ray(record.point, reflected + m_roughness * randomInUnitSphere());
+			scattered = Ray(record.point, reflected + m_roughness * sampleUnitSphere(sample));
 			attenuation = Color3(m_color);
 			return (glm::dot(scattered.direction(), record.normal) > 0);
 		}
@@ -96,7 +115,7 @@ bool Material::scatter(const Ray& r_in, const HitRecord& record, vec3& attenuati
 				reflect_probability = 1.0f;
 			}
 
-			if (drand48() < reflect_probability)
+			if (sample.x < reflect_probability)
 			{
 				scattered = Ray(record.point, reflected); // REFLECT vs
 			}
@@ -129,6 +148,20 @@ vec3 Material::emitted(const vec3& p) const
 	return vec3(0.0f, 0.0f, 0.0f);
 }
 
+float Material::scatterPdf(const HitRecord& record, const vec3& direction) const
+{
+	if (!isDiffuse())
+		return 0.0f;
+	return std::max(glm::dot(record.normal, direction), 0.0f) / Math::Pi;
+}
+
+vec3 Material::evaluate(const HitRecord& record, const vec3& direction) const
+{
+	if (!isDiffuse())
+		return vec3(0.0f, 0.0f, 0.0f);
+	return Color3(m_color) * (std::max(glm::dot(record.normal, direction), 0.0f) / Math::Pi);
+}
+
 void Material::generateFBO(NVGcontext* vg)
 {
 	m_frameBufferImage.generateFBO(vg);
@@ -54,8 +54,18 @@ public:
 	}
 
 	bool scatter(const Ray& r_in, const HitRecord& record, vec3& attenuation, Ray& scattered) const;
+	// The sample is three uniform numbers in [0, 1), which are all the randomness the scattering needs.
+	bool scatter(const Ray& r_in, const HitRecord& record, const vec3& sample, vec3& attenuation, Ray& scattered) const;
 	vec3 emitted(const vec3& p) const;
 
+	// The diffuse materials are also lit by sampling the lights directly, so they need the pdf and the value
+	// of the scattering for a given direction. For the other materials these are 0.
+	bool isDiffuse() const { return m_materialType == MaterialType::Lambertian; }
+	// The solid angle pdf of scatter() giving the direction.
+	float scatterPdf(const HitRecord& record, const vec3& direction) const;
+	// The BRDF times the cosine of the direction, for the light coming from the direction.
+	vec3 evaluate(const HitRecord& record, const vec3& direction) const;
+
 	void generateFBO(NVGcontext* vg);
 	void update(NVGcontext* vg, double time);
 
@@ -32,6 +32,7 @@ Mesh::Mesh(Mesh&& other)
 	m_normals = std::move(other.m_normals);
 	m_indices = std::move(other.m_indices);
 	m_aabb = std::move(other.m_aabb);
+	m_triangles = std::move(other.m_triangles);
 
 	createVBOs();
 }
@@ -48,6 +49,7 @@ Mesh& Mesh::operator=(Mesh&& other)
 		m_normals = std::move(other.m_normals);
 		m_indices = std::move(other.m_indices);
 		m_aabb = std::move(other.m_aabb);
+		m_triangles = std::move(other.m_triangles);
 
 		createVBOs();
 	}
@@ -140,96 +142,98 @@ void Mesh::freeVBOs()
 	m_indexBufferId		= 0;
 }
 
-// Möller-Trumbore ray triangle intersection
-// t is outDistance on the ray
-// u and v are coordinates on the triangle plane?
-bool Mesh::rayTriangleIntersection(const vec3& rayStart, const vec3& rayDirection,
-	const vec3& v1, const vec3& v2, const vec3& v3,
-	float& t, float& u, float& v/*, bool& frontFacing*/) const
+// Möller-Trumbore ray triangle intersection, with the edges precomputed by Mesh::buildTriangleBvh.
+// t is the distance on the ray. Backfacing triangles are not hit.
+bool MeshTriangles::rayTriangleIntersection(const vec3& rayStart, const vec3& rayDirection, int triangleIndex, float& t) const
 {
-	vec3 e2 = v3 - v1;            // second edge
-	vec3 e1 = v2 - v1;            // first edge
+	const vec3& e1 = edges1[triangleIndex];
+	const vec3& e2 = edges2[triangleIndex];
 	vec3 r = glm::cross(rayDirection, e2); // (rayDirection X e2)
-	vec3 s = rayStart - v1;       // translated ray origin
 	float a = glm::dot(e1, r);    // a = (d X e2) * e1
-	float f = 1.0f / a;
-	vec3 q = glm::cross(s, e1);
-	u = glm::dot(s, r);
-	//frontFacing = true;
 
 	const float epsilon = 0.000001f;
 
-	if (a > epsilon)
-	{
-		// Front facing triangle...
-		if (u < 0.0f || u > a)
-		{
-			return false;
-		}
+	// Ray is parallel to plane of the triangle, or the triangle is backfacing.
+	// (For backfacing triangles the u and v checks below would need flipped signs.)
+	if (a <= epsilon)
+		return false;
 
-		float v = glm::dot(rayDirection, q);
+	vec3 s = rayStart - vertices[triangleIndex]; // translated ray origin
+	float u = glm::dot(s, r);
+	if (u < 0.0f || u > a)
+		return false;
 
-		if (v < 0.0f || u + v > a)
-		{
-			return false;
-		}
-	}/* We are not interested in backfacing triangles currently
-	else if (a < -epsilon)
-	{
-		// Back facing triangle...
-		frontFacing = false;
-		if (u > 0.0f || u < a)
-		{
-			return false;
-		}
+	vec3 q = glm::cross(s, e1);
+	float v = glm::dot(rayDirection, q);
+	if (v < 0.0f || u + v > a)
+		return false;
 
-		float v = glm::dot(rayDirection, q);
+	t = glm::dot(e2, q) / a;
+	return true;
+}
 
-		if (v > 0.0f || u + v < a)
+bool MeshTriangles::hit(const mat4& invMatrix, const Ray& ray, float t_min, float t_max, HitRecord& record) const
+{
+	// Transform ray from world space into object local space. The direction is not normalized,
+	// so the distances on the local ray are the same as on the world space ray.
+	Ray transformedRay;
+	transformedRay.setOrigin(vec3(invMatrix * vec4(ray.origin(), 1.0f)));
+	transformedRay.setDirection(vec3(invMatrix * vec4(ray.direction(), 0.0f)));
+
+	float closestSoFar = t_max;
+	int hitTriangle = -1;
+
+	// The root node of the BVH replaces the test against the aabb.
+	bvh.traverse(transformedRay, t_min, closestSoFar, [&](int triangleIndex)
+	{
+		float hitDistance;
+		if (rayTriangleIntersection(transformedRay.origin(), transformedRay.direction(), triangleIndex, hitDistance)
+			&& hitDistance < closestSoFar
+			&& hitDistance > t_min)
 		{
-			return false;
+			closestSoFar = hitDistance;
+			hitTriangle = triangleIndex;
 		}
-	}
-	*/
-	else
-	{
-		// Ray is parallel to plane of the triangle (or backfacing as we've disabled that branch)
-		//frontFacing = false;
-		return false;
-	}
+	});
 
-	t = f * glm::dot(e2, q);
-	u = u * f;
-	v = v * f;
+	if (hitTriangle == -1)
+		return false;
 
+	record.t = closestSoFar;
+	record.point = ray.getPointAt(record.t);
+	// Normals go from local to world space with the inverse transpose of the world matrix.
+	record.normal = glm::normalize(glm::transpose(mat3(invMatrix)) * faceNormals[hitTriangle]); // currently just face normals
 	return true;
 }
 
 bool Mesh::hit(const Transform& transform, const Ray& ray, float t_min, float t_max, HitRecord& record) const
 {
-	// Transform ray from world space into object local space:
-	mat4 translationMatrix = glm::translate(mat4(1.0f), transform.position);
-	mat4 rotationMatrix = glm::toMat4(transform.rotation);
-	mat4 scaleMatrix = glm::scale(mat4(1.0f), transform.scale);
-	mat4 invMatrix =
-		glm::inverse(scaleMatrix) *
-		glm::inverse(rotationMatrix) *
-		glm::inverse(translationMatrix);
-
-	Ray transformedRay;
-	transformedRay.setOrigin(vec3(invMatrix * vec4(ray.origin(), 1.0f)));
-	transformedRay.setDirection(vec3(invMatrix * vec4(ray.direction(), 0.0f)));
+	return hit(transform.toInverseMatrix(), ray, t_min, t_max, record);
+}
 
-	if (m_aabb.hit(transformedRay, t_min, t_max) == false)
+bool Mesh::hit(const mat4& invMatrix, const Ray& ray, float t_min, float t_max, HitRecord& record) const
+{
+	if (!m_triangles)
 		return false;
+	return m_triangles->hit(invMatrix, ray, t_min, t_max, record);
+}
 
-	vec3 v0, v1, v2;
-	float u, v;
-	float hitDistance;
+void Mesh::buildTriangleBvh()
+{
+	const int count = triangleCount();
+
+	// A new one, as the old one may still be in use on the render thread.
+	auto triangles = std::make_shared<MeshTriangles>();
+	triangles->aabb = m_aabb;
+	triangles->vertices.resize(count);
+	triangles->edges1.resize(count);
+	triangles->edges2.resize(count);
+	triangles->faceNormals.resize(count);
 
-	bool isHit = false;
+	Array<Box> bounds(count);
 
-	for (int i = 0; i < triangleCount(); ++i)
+	vec3 v0, v1, v2;
+	for (int i = 0; i < count; ++i)
 	{
 		if (m_windingOrder == WindingOrder::CounterClockwise)
 		{
@@ -240,20 +244,20 @@ bool Mesh::hit(const Transform& transform, const Ray& ray, float t_min, float t_
 			getTriangle(i, v0, v2, v1);
 		}
 
-		if (rayTriangleIntersection(
-			transformedRay.origin(),
-			transformedRay.direction(), v0, v1, v2, hitDistance, u, v)
-				&& hitDistance < t_max
-				&& hitDistance > t_min)
-		{
-			isHit = true;
-			record.t = hitDistance;
-			record.point = ray.getPointAt(record.t);
-			record.normal = getFaceNormal(i); // currently just face normals
-		}
+		triangles->vertices[i] = v0;
+		triangles->edges1[i] = v1 - v0;
+		triangles->edges2[i] = v2 - v0;
+		triangles->faceNormals[i] = m_normals.size() == m_vertices.size()
+			? getFaceNormal(i)
+			: glm::normalize(glm::cross(v1 - v0, v2 - v0));
+
+		bounds[i].grow(v0);
+		bounds[i].grow(v1);
+		bounds[i].grow(v2);
 	}
 
-	return isHit;
+	triangles->bvh.build(bounds);
+	m_triangles = std::move(triangles);
 }
 
 void Mesh::getTriangle(int idx, vec3& out0, vec3& out1, vec3& out2) const
@@ -460,9 +464,10 @@ void Mesh::generateCube()
 		20, 22, 23
 	};
 
-	computeAabb();
 	computeFaceNormals();
 	computeOutlineNormals();
+	computeAabb();
+	buildTriangleBvh();
 
 	//LOG_F("size of: m_vertices: %i size of m_indices: %i", (int)m_vertices.size(), (int)m_indices.size());
 }
@@ -507,6 +512,7 @@ void Mesh::generateSphere(float radius, int rings, int sectors)
 	computeFaceNormals();
 	computeOutlineNormals();
 	computeAabb();
+	buildTriangleBvh();
 }
 
 void Mesh::generateCone(int steps)
@@ -556,6 +562,7 @@ void Mesh::generateCone(int steps)
 	computeFaceNormals();
 	computeOutlineNormals();
 	computeAabb();
+	buildTriangleBvh();
 }
 
 void Mesh::computeOutlineNormals()
@@ -899,6 +906,7 @@ bool Mesh::loadModel(const String& filepath)
 
 	// Aabb already computed inside loadNode because we need it for UV computation
 	//computeAabb();
+	buildTriangleBvh();
 	createVBOs();
 
 	LOG_F(INFO, "Succesfully imported scene %s", filepath.c_str());
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
@@ -14,6 +16,7 @@
 #include "rae/core/Types.hpp"
 
 #include "rae_ray/Hitable.hpp"
+#include "rae_ray/FlatBvh.hpp"
 #include "rae/visual/Box.hpp"
 
 namespace rae
@@ -26,6 +29,24 @@ enum class WindingOrder
 	// Not supported yet: TwoSided
 };
 
+// The ray tracing data of a Mesh, built by Mesh::buildTriangleBvh. It isn't modified after it's built, and it's
+// shared, so that the RenderScene of the render thread can keep using it while the Mesh is moved around in its
+// Table, or rebuilt. The triangles are in the winding order of the mesh, one element per triangle in each array.
+struct MeshTriangles
+{
+	// The inverseMatrix transforms the ray from world space to the local space of the mesh.
+	// Finds the closest hit through the BVH, and the normal in the record is in world space.
+	bool hit(const mat4& inverseMatrix, const Ray& ray, float t_min, float t_max, HitRecord& record) const;
+	bool rayTriangleIntersection(const vec3& rayStart, const vec3& rayDirection, int triangleIndex, float& t) const;
+
+	Box			aabb; // The local space bounds of the mesh.
+	FlatBvh		bvh;
+	Array<vec3>	vertices; // The first vertex of each triangle.
+	Array<vec3>	edges1; // From the first vertex to the second.
+	Array<vec3>	edges2; // From the first vertex to the third.
+	Array<vec3>	faceNormals;
+};
+
 class Mesh : public Hitable
 {
 public:
@@ -41,6 +62,10 @@ public:
 	// A silly fix for the need for a position from the instance:
 	virtual bool hit(const Ray& ray, float t_min, float t_max, HitRecord& record) const override { return false; };
 	virtual bool hit(const Transform& transform, const Ray& ray, float t_min, float t_max, HitRecord& record) const;
+	// The inverseMatrix transforms the ray from world space to the local space of the mesh.
+	// Usually it is the cached TransformSystem::getInverseWorldMatrix. Finds the closest hit through the triangle BVH,
+	// and the normal in the record is in world space.
+	bool hit(const mat4& inverseMatrix, const Ray& ray, float t_min, float t_max, HitRecord& record) const;
 	virtual Box getAabb(float t0 = 0.0f, float t1 = 0.0f) const override { return m_aabb; }
 
 	void generateCube();
@@ -59,6 +84,11 @@ public:
 	void renderLines(uint shaderProgramId) const;
 	int triangleCount() const { return int(m_indices.size()) / 3; }
 	void computeAabb();
+	// Builds the triangle BVH and the edge vectors used by hit into new MeshTriangles. Needs to be called after
+	// the vertices, indices, normals or the aabb change. The generate and load functions do it already.
+	void buildTriangleBvh();
+	// Null until buildTriangleBvh has been called.
+	const std::shared_ptr<const MeshTriangles>& triangles() const { return m_triangles; }
 	void computeFaceNormals();
 	Array<vec3> computeSmoothNormals();
 	void computeOutlineNormals();
@@ -72,9 +102,6 @@ public:
 
 protected:
 
-	bool rayTriangleIntersection(const vec3& rayStart, const vec3& rayDirection,
-		const vec3& v1, const vec3& v2, const vec3& v3,
-		float& t, float& u, float& v/*, bool& frontFacing*/) const;
 	void getTriangle(int idx, vec3& out0, vec3& out1, vec3& out2) const;
 	vec3 getFaceNormal(int idx) const;
 
@@ -96,6 +123,8 @@ protected:
 	WindingOrder m_windingOrder = WindingOrder::CounterClockwise;
 
 	Box m_aabb;
+
+	std::shared_ptr<const MeshTriangles> m_triangles;
 };
 
 } // end namespace rae
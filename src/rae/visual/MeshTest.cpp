@@ -0,0 +1,75 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae/visual/Mesh.hpp"
+#include "rae/visual/Ray.hpp"
+#include "rae_ray/HitRecord.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace rae;
+
+SCENARIO("Mesh ray hit unittest", "[rae][Mesh]")
+{
+	GIVEN( "a sphere mesh" )
+	{
+		Mesh mesh;
+		mesh.generateSphere(0.5f, 16, 16);
+
+		WHEN( "rays from the outside are cast through the center" )
+		{
+			THEN( "the closest triangle on the front side is hit, not the last one in the index order" )
+			{
+				const vec3 directions[] = { vec3(1,0,0), vec3(-1,0,0), vec3(0,1,0), vec3(0,-1,0), vec3(0,0,1), vec3(0,0,-1) };
+				for (auto&& direction : directions)
+				{
+					Ray ray(direction * 3.0f, -direction);
+					HitRecord record;
+					REQUIRE(mesh.hit(mat4(1.0f), ray, 0.001f, FLT_MAX, record) == true);
+					REQUIRE(record.t == Approx(2.5f).epsilon(0.02f));
+					REQUIRE(glm::dot(record.normal, direction) > 0.9f);
+				}
+			}
+		}
+
+		WHEN( "the mesh is scaled and moved" )
+		{
+			mat4 worldMatrix = glm::translate(mat4(1.0f), vec3(10.0f, 0.0f, 0.0f)) * glm::scale(mat4(1.0f), vec3(4.0f, 1.0f, 1.0f));
+			Ray ray(vec3(0.0f, 0.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f));
+			HitRecord record;
+			REQUIRE(mesh.hit(glm::inverse(worldMatrix), ray, 0.001f, FLT_MAX, record) == true);
+
+			THEN( "the hit distance and the normal are in world space" )
+			{
+				REQUIRE(record.t == Approx(8.0f).epsilon(0.02f));
+				REQUIRE(record.point.x == Approx(8.0f).epsilon(0.02f));
+				REQUIRE(glm::length(record.normal) == Approx(1.0f));
+				REQUIRE(record.normal.x < -0.5f);
+			}
+		}
+
+		WHEN( "the ray misses or the hit is beyond t_max" )
+		{
+			HitRecord record;
+			REQUIRE(mesh.hit(mat4(1.0f), Ray(vec3(3.0f, 3.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f)), 0.001f, FLT_MAX, record) == false);
+			REQUIRE(mesh.hit(mat4(1.0f), Ray(vec3(3.0f, 0.0f, 0.0f), vec3(-1.0f, 0.0f, 0.0f)), 0.001f, 2.0f, record) == false);
+		}
+
+		WHEN( "the mesh is move assigned to another one, like in a Table" )
+		{
+			Mesh other;
+			other = std::move(mesh);
+
+			THEN( "the other mesh is hit like the original" )
+			{
+				HitRecord record;
+				REQUIRE(other.hit(mat4(1.0f), Ray(vec3(3.0f, 0.0f, 0.0f), vec3(-1.0f, 0.0f, 0.0f)), 0.001f, FLT_MAX, record) == true);
+				REQUIRE(record.t == Approx(2.5f).epsilon(0.02f));
+			}
+		}
+	}
+}
+
+#endif
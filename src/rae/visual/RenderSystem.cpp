@@ -253,35 +253,21 @@ void RenderSystem::renderMeshes(const Scene& scene)
 
 	glDisable(GL_STENCIL_TEST);
 
-	query<MeshLink>(assetLinkSystem.meshLinks(), [&](Id id, const MeshLink& meshLink)
+	// Selected and hovered meshes are rendered below, with the stencil buffer enabled.
+	join(assetLinkSystem.meshLinks(), assetLinkSystem.materialLinks(), transformSystem.worldMatrices())
+		.without(selectionSystem.selectedByParent())
+		.without(selectionSystem.hovers())
+		.query([&](Id id, const MeshLink& meshLink, const MaterialLink& materialLink, const mat4& modelMatrix)
 	{
-		bool selected = selectionSystem.isPartOfSelection(id);
-		bool hovered = selectionSystem.isHovered(id);
+		const Material& material = m_assetSystem.getMaterial(materialLink);
+		const Mesh& mesh = m_assetSystem.getMesh(meshLink);
 
-		if (!selected && !hovered)
-		{
-			Material* material = nullptr;
+		#ifdef RAE_DEBUG
+			LOG_F(INFO, "Going to render Mesh. id: %i", id);
+			LOG_F(INFO, "MeshLink is: %i", meshLink);
+		#endif
 
-			if (assetLinkSystem.m_materialLinks.check(id))
-				material = &m_assetSystem.modifyMaterial(assetLinkSystem.materialLinks().get(id));
-
-			if (transformSystem.hasWorldTransform(id) &&
-				material)
-			{
-				const Mesh& mesh = m_assetSystem.getMesh(assetLinkSystem.meshLinks().get(id));
-				const Transform& transform = transformSystem.getWorldTransform(id);
-
-				//debugMaterial = &material;
-				//debugMesh = &mesh;
-
-				#ifdef RAE_DEBUG
-					LOG_F(INFO, "Going to render Mesh. id: %i", id);
-					LOG_F(INFO, "MeshLink is: %i", assetLinkSystem.meshLinks().get(id));
-				#endif
-
-				renderMesh(camera, transform, *material, mesh);
-			}
-		}
+		renderMesh(camera, modelMatrix, material, mesh);
 	});
 
 	glEnable(GL_STENCIL_TEST);
@@ -289,42 +275,40 @@ void RenderSystem::renderMeshes(const Scene& scene)
 	glStencilFunc(GL_ALWAYS, 1, 0xFF); // All fragments should update the stencil buffer.
 	glStencilMask(0xFF); // Enable writing to the stencil buffer.
 
-	query<Selected>(selectionSystem.selectedByParent(), [&](Id id)
+	queryIds<Selected>(selectionSystem.selectedByParent(), [&](Id id)
 	{
-		Material* material = nullptr;
+		const Material* material = nullptr;
 
 		if (assetLinkSystem.m_materialLinks.check(id))
-			material = &m_assetSystem.modifyMaterial(assetLinkSystem.materialLinks().get(id));
+			material = &m_assetSystem.getMaterial(assetLinkSystem.materialLinks().get(id));
 
-		if (transformSystem.hasWorldTransform(id) &&
+		if (transformSystem.hasWorldMatrix(id) &&
 			material)
 		{
 			const Mesh& mesh = m_assetSystem.getMesh(assetLinkSystem.meshLinks().get(id));
-			const Transform& transform = transformSystem.getWorldTransform(id);
 
-			renderMesh(camera, transform, *material, mesh);
+			renderMesh(camera, transformSystem.getWorldMatrix(id), *material, mesh);
 		}
 	});
 
 	// RAE_TODO This is pretty stupid. We need a separate query for hovers. We should try to combine hover and selected
 	// queries so we can do this in one step.
-	query<Hover>(selectionSystem.hovers(), [&](Id id)
+	queryIds<Hover>(selectionSystem.hovers(), [&](Id id)
 	{
 		bool selected = selectionSystem.isPartOfSelection(id);
 		if (!selected)
 		{
-			Material* material = nullptr;
+			const Material* material = nullptr;
 
 			if (assetLinkSystem.m_materialLinks.check(id))
-				material = &m_assetSystem.modifyMaterial(assetLinkSystem.materialLinks().get(id));
+				material = &m_assetSystem.getMaterial(assetLinkSystem.materialLinks().get(id));
 
-			if (transformSystem.hasWorldTransform(id) &&
+			if (transformSystem.hasWorldMatrix(id) &&
 				material)
 			{
 				const Mesh& mesh = m_assetSystem.getMesh(assetLinkSystem.meshLinks().get(id));
-				const Transform& transform = transformSystem.getWorldTransform(id);
 
-				renderMesh(camera, transform, *material, mesh);
+				renderMesh(camera, transformSystem.getWorldMatrix(id), *material, mesh);
 			}
 		}
 	});
@@ -361,13 +345,13 @@ void RenderSystem::renderOutline(const Scene& scene)
 	{
 		bool selected = selectionSystem.isPartOfSelection(id);
 		bool hovered = selectionSystem.isHovered(id);
-		if ((selected || hovered) && transformSystem.hasWorldTransform(id))
+		if ((selected || hovered) && transformSystem.hasWorldMatrix(id))
 		{
 			const Mesh& mesh = m_assetSystem.getMesh(assetLinkSystem.meshLinks().get(id));
-			Transform transform = transformSystem.getWorldTransform(id);
-			//transform.scale = transform.scale * 1.2f;
+			const Transform& transform = transformSystem.getWorldTransform(id);
 
-			renderMeshOutline(camera, transform, hovered ? hoverColor : activeColor, mesh);
+			renderMeshOutline(camera, transform, transformSystem.getWorldMatrix(id),
+				hovered ? hoverColor : activeColor, mesh);
 		}
 	});
 
@@ -394,13 +378,11 @@ void RenderSystem::renderNormals(const Scene& scene)
 	query<MeshLink>(assetLinkSystem.meshLinks(), [&](Id id, const MeshLink& meshLink)
 	{
 		bool selected = selectionSystem.isPartOfSelection(id);
-		if (selected && transformSystem.hasWorldTransform(id))
+		if (selected && transformSystem.hasWorldMatrix(id))
 		{
 			const Mesh& mesh = m_assetSystem.getMesh(assetLinkSystem.meshLinks().get(id));
-			Transform transform = transformSystem.getWorldTransform(id);
-			//transform.scale = transform.scale * 1.2f;
 
-			renderMeshNormals(camera, transform, normalColor, mesh, id);
+			renderMeshNormals(camera, transformSystem.getWorldMatrix(id), normalColor, mesh, id);
 		}
 	});
 
@@ -441,32 +423,25 @@ void RenderSystem::renderPicking(const Window& window)
 	{
 		const Mesh& mesh = m_assetSystem.getMesh(assetLinkSystem.m_meshLinks.get(id));
 
-		if (transformSystem.hasWorldTransform(id))
+		if (transformSystem.hasWorldMatrix(id))
 		{
-			const Transform& transform = transformSystem.getWorldTransform(id);
-
 			#ifdef RAE_DEBUG
 				LOG_F(INFO, "Going to render Mesh. id: %i", id);
 			#endif
 
-			renderMeshPicking(camera, transform, mesh, id);
+			renderMeshPicking(camera, transformSystem.getWorldMatrix(id), mesh, id);
 		}
 	});
 }
 
 void RenderSystem::renderMesh(
 	const Camera& camera,
-	const Transform& transform,
+	const mat4& modelMatrix,
 	const Material& material,
 	const Mesh& mesh)
 {
 	glFrontFace(mesh.glWindingOrder());
 
-	mat4 translationMatrix = glm::translate(mat4(1.0f), transform.position);
-	mat4 rotationMatrix = glm::toMat4(transform.rotation);
-	mat4 scaleMatrix = glm::scale(mat4(1.0f), transform.scale);
-	mat4 modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
-
 	// The model-view-projection matrix
 	glm::mat4 combinedMatrix = camera.getProjectionAndViewMatrix() * modelMatrix;
 
@@ -487,16 +462,20 @@ void RenderSystem::renderMeshSingleColor(
 	const Transform& transform,
 	const Color& color,
 	const Mesh& mesh)
+{
+	renderMeshSingleColor(camera, transform.toMatrix(), color, mesh);
+}
+
+void RenderSystem::renderMeshSingleColor(
+	const Camera& camera,
+	const mat4& modelMatrix,
+	const Color& color,
+	const Mesh& mesh)
 {
 	glFrontFace(mesh.glWindingOrder());
 
 	m_singleColorShader.use();
 
-	mat4 translationMatrix = glm::translate(mat4(1.0f), transform.position);
-	mat4 rotationMatrix = glm::toMat4(transform.rotation);
-	mat4 scaleMatrix = glm::scale(mat4(1.0f), transform.scale);
-	mat4 modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
-
 	// The model-view-projection matrix
 	glm::mat4 combinedMatrix = camera.getProjectionAndViewMatrix() * modelMatrix;
 
@@ -509,6 +488,7 @@ void RenderSystem::renderMeshSingleColor(
 void RenderSystem::renderMeshOutline(
 	const Camera& camera,
 	const Transform& transform,
+	const mat4& modelMatrix,
 	const Color& color,
 	const Mesh& mesh)
 {
@@ -521,11 +501,6 @@ void RenderSystem::renderMeshOutline(
 		* t_outlineMultiplier
 		* (1.0f / transform.scale.x); // Compensate for the effect of transform scale.
 
-	mat4 translationMatrix = glm::translate(mat4(1.0f), transform.position);
-	mat4 rotationMatrix = glm::toMat4(transform.rotation);
-	mat4 scaleMatrix = glm::scale(mat4(1.0f), transform.scale);
-	mat4 modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
-
 	// The model-view-projection matrix
 	glm::mat4 combinedMatrix = camera.getProjectionAndViewMatrix() * modelMatrix;
 
@@ -538,18 +513,13 @@ void RenderSystem::renderMeshOutline(
 
 void RenderSystem::renderMeshNormals(
 	const Camera& camera,
-	const Transform& transform,
+	const mat4& modelMatrix,
 	const Color& color,
 	const Mesh& mesh,
 	Id cacheId)
 {
 	m_singleColorShader.use();
 
-	mat4 translationMatrix = glm::translate(mat4(1.0f), transform.position);
-	mat4 rotationMatrix = glm::toMat4(transform.rotation);
-	mat4 scaleMatrix = glm::scale(mat4(1.0f), transform.scale);
-	mat4 modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
-
 	// The model-view-projection matrix
 	glm::mat4 combinedMatrix = camera.getProjectionAndViewMatrix() * modelMatrix;
 
@@ -587,17 +557,12 @@ void RenderSystem::renderMeshNormals(
 
 void RenderSystem::renderMeshPicking(
 	const Camera& camera,
-	const Transform& transform,
+	const mat4& modelMatrix,
 	const Mesh& mesh,
 	Id id)
 {
 	glFrontFace(mesh.glWindingOrder());
 
-	mat4 translationMatrix = glm::translate(mat4(1.0f), transform.position);
-	mat4 rotationMatrix = glm::toMat4(transform.rotation);
-	mat4 scaleMatrix = glm::scale(mat4(1.0f), transform.scale);
-	mat4 modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
-
 	// The model-view-projection matrix
 	glm::mat4 combinedMatrix = camera.getProjectionAndViewMatrix() * modelMatrix;
 
@@ -90,9 +90,10 @@ public:
 		float x, float y, float w, float h);
 	ImageBuffer<uint8_t>& getBackgroundImage() { return m_backgroundImage; }
 
+	// The modelMatrix is usually the cached TransformSystem::getWorldMatrix.
 	void renderMesh(
 		const Camera& camera,
-		const Transform& transform,
+		const mat4& modelMatrix,
 		const Material& material,
 		const Mesh& mesh);
 
@@ -102,22 +103,29 @@ public:
 		const Color& color,
 		const Mesh& mesh);
 
+	void renderMeshSingleColor(
+		const Camera& camera,
+		const mat4& modelMatrix,
+		const Color& color,
+		const Mesh& mesh);
+
 	void renderMeshOutline(
 		const Camera& camera,
 		const Transform& transform,
+		const mat4& modelMatrix,
 		const Color& color,
 		const Mesh& mesh);
 
 	void renderMeshNormals(
 		const Camera& camera,
-		const Transform& transform,
+		const mat4& modelMatrix,
 		const Color& color,
 		const Mesh& mesh,
 		Id cacheId);
 
 	void renderMeshPicking(
 		const Camera& camera,
-		const Transform& transform,
+		const mat4& modelMatrix,
 		const Mesh& mesh,
 		Id id);
 
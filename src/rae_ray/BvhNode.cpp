@@ -18,7 +18,7 @@ void BvhNode::init(Array<Hitable*>& hitables, float time0, float time1)
 {
 	g_deep++;
 
-	int axis = int(3 * drand48());
+	int axis = int(3 * getRandom());
 
 	// A much cleaner comparison function than in Shirley's book.
 	// We use a lambda which captures the axis.
@@ -0,0 +1,119 @@
+#include "rae_ray/ConvergenceBuffer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "rae/core/ThreadPool.hpp"
+
+using namespace rae;
+
+namespace
+{
+
+const float DarkLuminance = 0.1f;
+
+float luminance(const vec3& color)
+{
+	return 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
+}
+
+}
+
+void ConvergenceBuffer::init(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_pixels.assign(width * height, PixelStatistics());
+}
+
+void ConvergenceBuffer::clear()
+{
+	std::fill(m_pixels.begin(), m_pixels.end(), PixelStatistics());
+}
+
+void ConvergenceBuffer::addSample(int x, int y, const vec3& color)
+{
+	PixelStatistics& pixel = m_pixels[y * m_width + x];
+	float value = luminance(color);
+
+	pixel.sampleCount++;
+	float delta = value - pixel.mean;
+	pixel.mean += delta / float(pixel.sampleCount);
+	pixel.m2 += delta * (value - pixel.mean);
+}
+
+void ConvergenceBuffer::copyPixel(const ConvergenceBuffer& source, int sourceX, int sourceY, int x, int y, int maxSampleCount)
+{
+	PixelStatistics pixel = source.m_pixels[sourceY * source.m_width + sourceX];
+	if (pixel.sampleCount > maxSampleCount)
+	{
+		// m2 is the variance times the sample count (minus one), so it's scaled down with the count.
+		pixel.m2 *= float(maxSampleCount - 1) / float(pixel.sampleCount - 1);
+		pixel.sampleCount = maxSampleCount;
+	}
+	m_pixels[y * m_width + x] = pixel;
+}
+
+float ConvergenceBuffer::meanVariance(int x, int y) const
+{
+	const PixelStatistics& pixel = m_pixels[y * m_width + x];
+	if (pixel.sampleCount < 2)
+		return -1.0f;
+
+	float n = float(pixel.sampleCount);
+	float variance = pixel.m2 / (n - 1.0f);
+	return std::max(variance, 0.0f) / n;
+}
+
+float ConvergenceBuffer::relativeError(int x, int y) const
+{
+	float variance = meanVariance(x, y);
+	if (variance < 0.0f)
+		return FLT_MAX;
+
+	float standardError = std::sqrt(variance);
+	return standardError / (m_pixels[y * m_width + x].mean + DarkLuminance);
+}
+
+bool ConvergenceBuffer::isConverged(int x, int y, float threshold) const
+{
+	return sampleCount(x, y) >= AdaptiveMinSamples && relativeError(x, y) < threshold;
+}
+
+bool ConvergenceBuffer::isConverged(const Tile& tile, float threshold) const
+{
+	for (int y = tile.y; y < tile.y + tile.height; ++y)
+	{
+		for (int x = tile.x; x < tile.x + tile.width; ++x)
+		{
+			if (!isConverged(x, y, threshold))
+				return false;
+		}
+	}
+	return true;
+}
+
+void ConvergenceBuffer::writeHeatMap(ImageBuffer<float>& target, float threshold, ThreadPool& pool) const
+{
+	assert(target.width() == m_width);
+	assert(target.height() == m_height);
+
+	pool.run(m_height, [&](int y)
+	{
+		for (int x = 0; x < m_width; ++x)
+		{
+			if (sampleCount(x, y) < 2)
+			{
+				target.setPixelColor3(x, y, vec3(0.0f, 0.0f, 0.0f));
+				continue;
+			}
+
+			float t = std::min(relativeError(x, y) / (2.0f * threshold), 1.0f);
+			if (isConverged(x, y, threshold))
+				t = 0.0f;
+			// Squared, so that it's roughly the same colors after the gamma correction.
+			target.setPixelColor3(x, y, vec3(t * t, (1.0f - t) * (1.0f - t), 0.0f));
+		}
+	});
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "rae/core/Types.hpp"
+#include "rae/image/ImageBuffer.hpp"
+#include "rae_ray/RenderTiles.hpp"
+
+namespace rae
+{
+
+class ThreadPool;
+
+// Below this many samples the variance estimate is too unreliable to call a pixel converged.
+const int AdaptiveMinSamples = 16;
+
+// Per pixel sample counts and running variances (Welford's algorithm) of the luminance of the samples, kept next to
+// the accumulated color of the ray tracer. Used for adaptive sampling: the tiles where the estimated error has
+// dropped below a threshold can be skipped, so that the passes get shorter and the noisy tiles get more samples.
+class ConvergenceBuffer
+{
+public:
+	void init(int width, int height);
+	void clear();
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+
+	int sampleCount(int x, int y) const { return m_pixels[y * m_width + x].sampleCount; }
+	void addSample(int x, int y, const vec3& color);
+
+	// For moving the samples to another pixel, when the camera moves. At most maxSampleCount samples are kept,
+	// with the same mean and variance, so that the new samples get more weight than the history.
+	void copyPixel(const ConvergenceBuffer& source, int sourceX, int sourceY, int x, int y, int maxSampleCount);
+	void clearPixel(int x, int y) { m_pixels[y * m_width + x] = PixelStatistics(); }
+
+	// The standard error of the mean luminance of the pixel, relative to the mean luminance.
+	// A small constant is added to the mean, so that dark pixels don't need to be perfectly clean.
+	float relativeError(int x, int y) const;
+	// The estimated variance of the mean luminance of the pixel, or -1 with less than two samples.
+	float meanVariance(int x, int y) const;
+	bool isConverged(int x, int y, float threshold) const;
+	bool isConverged(const Tile& tile, float threshold) const;
+
+	// Debug view: black for pixels without samples, and from green for converged pixels to red for pixels
+	// with twice the threshold error or more. The colors are linear, like the colors of the ray tracer.
+	// The rows are written in parallel on the pool.
+	void writeHeatMap(ImageBuffer<float>& target, float threshold, ThreadPool& pool) const;
+
+protected:
+	struct PixelStatistics
+	{
+		int sampleCount = 0;
+		float mean = 0.0f;
+		float m2 = 0.0f; // Sum of the squared differences from the mean.
+	};
+
+	int m_width = 0;
+	int m_height = 0;
+	Array<PixelStatistics> m_pixels;
+};
+
+} // namespace rae
@@ -0,0 +1,83 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/ConvergenceBuffer.hpp"
+#include "rae/core/Random.hpp"
+
+using namespace rae;
+
+SCENARIO("ConvergenceBuffer unittest", "[rae][ConvergenceBuffer]")
+{
+	GIVEN( "a convergence buffer with a constant pixel and a noisy pixel" )
+	{
+		ConvergenceBuffer buffer;
+		buffer.init(2, 1);
+		Pcg32 random;
+		random.setSeed(7);
+
+		for (int i = 0; i < 64; ++i)
+		{
+			buffer.addSample(0, 0, vec3(0.5f, 0.5f, 0.5f));
+			float value = random.nextFloat() < 0.5f ? 0.0f : 4.0f;
+			buffer.addSample(1, 0, vec3(value, value, value));
+		}
+
+		THEN( "the sample counts are tracked per pixel" )
+		{
+			REQUIRE( buffer.sampleCount(0, 0) == 64 );
+			REQUIRE( buffer.sampleCount(1, 0) == 64 );
+		}
+
+		THEN( "only the constant pixel is converged" )
+		{
+			REQUIRE( buffer.relativeError(0, 0) < 0.001f );
+			REQUIRE( buffer.isConverged(0, 0, 0.02f) );
+			REQUIRE_FALSE( buffer.isConverged(1, 0, 0.02f) );
+
+			Tile tile;
+			tile.width = 2;
+			tile.height = 1;
+			REQUIRE_FALSE( buffer.isConverged(tile, 0.02f) );
+			tile.width = 1;
+			REQUIRE( buffer.isConverged(tile, 0.02f) );
+		}
+
+		THEN( "clearing forgets the samples" )
+		{
+			buffer.clear();
+			REQUIRE( buffer.sampleCount(0, 0) == 0 );
+			REQUIRE_FALSE( buffer.isConverged(0, 0, 0.02f) );
+		}
+
+		THEN( "a copied pixel keeps the variance of the samples with fewer samples" )
+		{
+			ConvergenceBuffer copy;
+			copy.init(1, 1);
+			copy.copyPixel(buffer, 1, 0, 0, 0, 8);
+			REQUIRE( copy.sampleCount(0, 0) == 8 );
+			REQUIRE( copy.meanVariance(0, 0) == Approx(buffer.meanVariance(1, 0) * 8.0f).epsilon(0.001) );
+
+			copy.clearPixel(0, 0);
+			REQUIRE( copy.sampleCount(0, 0) == 0 );
+		}
+	}
+
+	GIVEN( "a constant pixel with too few samples" )
+	{
+		ConvergenceBuffer buffer;
+		buffer.init(1, 1);
+		for (int i = 0; i < AdaptiveMinSamples - 1; ++i)
+		{
+			buffer.addSample(0, 0, vec3(1.0f, 1.0f, 1.0f));
+		}
+
+		THEN( "it's not converged yet" )
+		{
+			REQUIRE_FALSE( buffer.isConverged(0, 0, 0.02f) );
+		}
+	}
+}
+
+#endif
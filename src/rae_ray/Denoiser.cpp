@@ -0,0 +1,180 @@
+#include "rae_ray/Denoiser.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "rae/core/ThreadPool.hpp"
+#include "rae_ray/ConvergenceBuffer.hpp"
+
+using namespace rae;
+
+namespace
+{
+
+// The albedo is clamped before dividing by it, so that black materials don't blow up the noise.
+const float MinAlbedo = 0.01f;
+
+// A 3x3 B-spline kernel. The original paper uses 5x5, but with the holes 3x3 is
+// almost as smooth for under half of the taps.
+const float KernelWeights[3] = { 0.25f, 0.5f, 0.25f };
+
+float squaredLength(const vec3& value)
+{
+	return glm::dot(value, value);
+}
+
+float luminance(const vec3& color)
+{
+	return 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
+}
+
+vec3 demodulationAlbedo(const vec3& albedo)
+{
+	return glm::max(albedo, vec3(MinAlbedo));
+}
+
+}
+
+void Denoiser::init(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_albedo.assign(width * height, vec3(0.0f));
+	m_normal.assign(width * height, vec3(0.0f));
+	m_lighting.assign(width * height, vec3(0.0f));
+	m_filteredLighting.assign(width * height, vec3(0.0f));
+	m_variance.assign(width * height, 0.0f);
+	m_filteredVariance.assign(width * height, 0.0f);
+}
+
+void Denoiser::clear()
+{
+	std::fill(m_albedo.begin(), m_albedo.end(), vec3(0.0f));
+	std::fill(m_normal.begin(), m_normal.end(), vec3(0.0f));
+}
+
+void Denoiser::addFeatures(int x, int y, int sampleIndex, const DenoiseFeatures& features)
+{
+	const int index = y * m_width + x;
+	const float weight = 1.0f / float(sampleIndex + 1);
+	m_albedo[index] += (features.albedo - m_albedo[index]) * weight;
+	m_normal[index] += (features.normal - m_normal[index]) * weight;
+}
+
+void Denoiser::copyFeatures(const Denoiser& source, int sourceX, int sourceY, int x, int y)
+{
+	const int sourceIndex = sourceY * source.m_width + sourceX;
+	const int index = y * m_width + x;
+	m_albedo[index] = source.m_albedo[sourceIndex];
+	m_normal[index] = source.m_normal[sourceIndex];
+}
+
+void Denoiser::clearFeatures(int x, int y)
+{
+	const int index = y * m_width + x;
+	m_albedo[index] = vec3(0.0f);
+	m_normal[index] = vec3(0.0f);
+}
+
+void Denoiser::denoise(
+	const ImageBuffer<float>& source,
+	const ConvergenceBuffer& convergence,
+	ImageBuffer<float>& target,
+	ThreadPool& pool)
+{
+	assert(source.width() == m_width && source.height() == m_height);
+	assert(convergence.width() == m_width && convergence.height() == m_height);
+	assert(target.width() == m_width && target.height() == m_height);
+
+	pool.run(m_height, [&](int y)
+	{
+		for (int x = 0; x < m_width; ++x)
+		{
+			const int index = y * m_width + x;
+			const vec3 albedo = demodulationAlbedo(m_albedo[index]);
+			m_lighting[index] = source.getPixelColor3(x, y) / albedo;
+
+			// The variance is of the color, so it's scaled like the lighting. Without an estimate yet,
+			// the noise is assumed to be as big as the lighting itself.
+			float variance = convergence.meanVariance(x, y);
+			float albedoLuminance = luminance(albedo);
+			float lightingLuminance = luminance(m_lighting[index]);
+			m_variance[index] = (variance >= 0.0f)
+				? variance / (albedoLuminance * albedoLuminance)
+				: lightingLuminance * lightingLuminance;
+		}
+	});
+
+	for (int i = 0; i < m_iterations; ++i)
+	{
+		filterPass(1 << i, pool);
+		m_lighting.swap(m_filteredLighting);
+		m_variance.swap(m_filteredVariance);
+	}
+
+	pool.run(m_height, [&](int y)
+	{
+		for (int x = 0; x < m_width; ++x)
+		{
+			const int index = y * m_width + x;
+			target.setPixelColor3(x, y, m_lighting[index] * demodulationAlbedo(m_albedo[index]));
+		}
+	});
+}
+
+void Denoiser::filterPass(int stepSize, ThreadPool& pool)
+{
+	const float normalFactor = 1.0f / (m_normalSigma * m_normalSigma);
+	const float albedoFactor = 1.0f / (m_albedoSigma * m_albedoSigma);
+
+	pool.run(m_height, [&](int y)
+	{
+		for (int x = 0; x < m_width; ++x)
+		{
+			const int index = y * m_width + x;
+			const float centerLuminance = luminance(m_lighting[index]);
+			const vec3& normal = m_normal[index];
+			const vec3& albedo = m_albedo[index];
+
+			// Differences smaller than the noise are just noise, so they don't stop the filter.
+			const float colorScale = 1.0f / (m_colorSigma * std::sqrt(m_variance[index]) + 1e-4f);
+
+			vec3 sum = vec3(0.0f);
+			float weightSum = 0.0f;
+			float varianceSum = 0.0f;
+
+			for (int ky = -1; ky <= 1; ++ky)
+			{
+				const int sy = y + ky * stepSize;
+				if (sy < 0 || sy >= m_height)
+					continue;
+
+				for (int kx = -1; kx <= 1; ++kx)
+				{
+					const int sx = x + kx * stepSize;
+					if (sx < 0 || sx >= m_width)
+						continue;
+
+					const int sampleIndex = sy * m_width + sx;
+
+					// The edge stopping functions: the weight drops where the features differ.
+					float exponent =
+						std::abs(luminance(m_lighting[sampleIndex]) - centerLuminance) * colorScale +
+						squaredLength(m_normal[sampleIndex] - normal) * normalFactor +
+						squaredLength(m_albedo[sampleIndex] - albedo) * albedoFactor;
+
+					float weight = KernelWeights[kx + 1] * KernelWeights[ky + 1] * std::exp(-exponent);
+					sum += m_lighting[sampleIndex] * weight;
+					varianceSum += m_variance[sampleIndex] * weight * weight;
+					weightSum += weight;
+				}
+			}
+
+			// The centre tap always has a weight, so the sum is never zero.
+			m_filteredLighting[index] = sum / weightSum;
+			// The variance of the weighted average, for the next iteration.
+			m_filteredVariance[index] = varianceSum / (weightSum * weightSum);
+		}
+	});
+}
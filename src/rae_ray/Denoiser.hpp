@@ -0,0 +1,81 @@
+#pragma once
+
+#include "rae/core/Types.hpp"
+#include "rae/image/ImageBuffer.hpp"
+
+namespace rae
+{
+
+class ConvergenceBuffer;
+class ThreadPool;
+
+// The features of the first hit of a path, which guide the denoiser. For the rays which miss the scene the albedo is
+// the sky color and the normal is zero.
+struct DenoiseFeatures
+{
+	vec3 albedo;
+	vec3 normal;
+};
+
+// Edge-avoiding à-trous wavelet filter (Dammertz et al. 2010, "Edge-Avoiding À-Trous Wavelet Transform for fast Global
+// Illumination Filtering"), guided by the albedo and normal of the first hits. The color is divided by the albedo
+// before filtering, so that only the lighting gets blurred and the textures and material edges stay sharp.
+// The color differences are compared to the estimated noise of the pixels, like in SVGF (Schied et al. 2017),
+// so the filter blurs a lot at low sample counts and less and less as the image converges.
+// Usage example:
+// denoiser.init(width, height);
+// denoiser.addFeatures(x, y, sampleIndex, features); // For each sample, from the render threads.
+// denoiser.denoise(colorBuffer, convergenceBuffer, denoisedBuffer, ThreadPool::shared());
+class Denoiser
+{
+public:
+	void init(int width, int height);
+	void clear();
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+
+	// Adds the features of a sample to the running average of the pixel, like the color is averaged in the ray tracer.
+	void addFeatures(int x, int y, int sampleIndex, const DenoiseFeatures& features);
+
+	// For moving the features to another pixel, when the camera moves.
+	void copyFeatures(const Denoiser& source, int sourceX, int sourceY, int x, int y);
+	void clearFeatures(int x, int y);
+
+	// Filters the source color into the target, using the variances of the convergence buffer. All of them must be
+	// the size of the denoiser. The rows are filtered in parallel on the pool.
+	void denoise(
+		const ImageBuffer<float>& source,
+		const ConvergenceBuffer& convergence,
+		ImageBuffer<float>& target,
+		ThreadPool& pool);
+
+	// Each iteration doubles the radius of the filter. 5 iterations cover 63x63 pixels.
+	int iterations() const { return m_iterations; }
+	void setIterations(int iterations) { m_iterations = iterations; }
+
+protected:
+	// One iteration of the filter with the holes ("trous") of stepSize - 1 pixels between the taps.
+	void filterPass(int stepSize, ThreadPool& pool);
+
+	int m_width = 0;
+	int m_height = 0;
+
+	int m_iterations = 5;
+	// How much the lighting (in standard deviations of its noise), normals and albedo can differ
+	// before the neighbours stop counting.
+	float m_colorSigma = 4.0f;
+	float m_normalSigma = 0.3f;
+	float m_albedoSigma = 0.1f;
+
+	Array<vec3> m_albedo;
+	Array<vec3> m_normal;
+
+	// The demodulated lighting and the variance of its luminance, ping-ponged between the iterations.
+	Array<vec3> m_lighting;
+	Array<vec3> m_filteredLighting;
+	Array<float> m_variance;
+	Array<float> m_filteredVariance;
+};
+
+} // namespace rae
@@ -0,0 +1,87 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/Denoiser.hpp"
+#include "rae_ray/ConvergenceBuffer.hpp"
+#include "rae/core/ThreadPool.hpp"
+#include "rae/core/Random.hpp"
+
+using namespace rae;
+
+SCENARIO("Denoiser unittest", "[rae][Denoiser]")
+{
+	GIVEN( "a noisy image of two surfaces with different normals, rendered with 16 samples" )
+	{
+		const int width = 64;
+		const int height = 32;
+		const int sampleCount = 16;
+
+		Denoiser denoiser;
+		denoiser.init(width, height);
+		ConvergenceBuffer convergence;
+		convergence.init(width, height);
+
+		ImageBuffer<float> noisy(width, height);
+		ImageBuffer<float> denoised(width, height);
+
+		Pcg32 random;
+		random.setSeed(3);
+
+		// The left half is lit with 0.2 and the right half with 0.8, with the same albedo.
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				const bool isLeft = x < width / 2;
+				DenoiseFeatures features;
+				features.albedo = vec3(0.5f);
+				features.normal = isLeft ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f);
+
+				vec3 color = vec3(0.0f);
+				for (int i = 0; i < sampleCount; ++i)
+				{
+					vec3 sample = vec3((isLeft ? 0.2f : 0.8f) * 0.5f * (2.0f * random.nextFloat()));
+					color += sample / float(sampleCount);
+					convergence.addSample(x, y, sample);
+					denoiser.addFeatures(x, y, i, features);
+				}
+				noisy.setPixelColor3(x, y, color);
+			}
+		}
+
+		denoiser.denoise(noisy, convergence, denoised, ThreadPool::shared());
+
+		auto squaredError = [&](const ImageBuffer<float>& image, int fromX, int toX, float expected)
+		{
+			float error = 0.0f;
+			for (int y = 0; y < height; ++y)
+			{
+				for (int x = fromX; x < toX; ++x)
+				{
+					float difference = image.getPixelColor3(x, y).r - expected;
+					error += difference * difference;
+				}
+			}
+			return error / float((toX - fromX) * height);
+		};
+
+		THEN( "the noise is reduced on both surfaces" )
+		{
+			REQUIRE( squaredError(denoised, 0, width / 2, 0.1f) < 0.1f * squaredError(noisy, 0, width / 2, 0.1f) );
+			REQUIRE( squaredError(denoised, width / 2, width, 0.4f) < 0.1f * squaredError(noisy, width / 2, width, 0.4f) );
+		}
+
+		THEN( "the edge between the surfaces is not blurred" )
+		{
+			for (int y = 0; y < height; ++y)
+			{
+				REQUIRE( denoised.getPixelColor3(width / 2 - 1, y).r < 0.2f );
+				REQUIRE( denoised.getPixelColor3(width / 2, y).r > 0.3f );
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "rae_ray/FlatBvh.hpp"
+
+using namespace rae;
+
+namespace
+{
+
+// Half of the surface area, which is enough for comparing the SAH costs.
+float halfArea(const Box& box)
+{
+	if (!box.valid())
+		return 0.0f;
+	vec3 d = box.dimensions();
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+}
+
+const int FlatBvh::BinCount;
+const int FlatBvh::MaxLeafSize;
+const int FlatBvh::MaxDepth;
+
+void FlatBvh::clear()
+{
+	m_nodes.clear();
+	m_itemIndices.clear();
+	m_itemBounds.clear();
+	m_itemCentroids.clear();
+	m_depth = 0;
+}
+
+void FlatBvh::build(const Array<Box>& bounds, int batchSize)
+{
+	clear();
+	m_batchSize = batchSize;
+
+	m_itemBounds = bounds;
+	m_itemCentroids.resize(bounds.size());
+	m_itemIndices.reserve(bounds.size());
+	for (int i = 0; i < (int)bounds.size(); ++i)
+	{
+		// Items without bounds (e.g. empty meshes) can never be hit, so they are left out.
+		if (!bounds[i].valid())
+			continue;
+
+		m_itemIndices.emplace_back(i);
+		m_itemCentroids[i] = (bounds[i].min() + bounds[i].max()) * 0.5f;
+	}
+
+	if (m_itemIndices.empty())
+		return;
+
+	m_nodes.reserve(m_itemIndices.size() * 2);
+	m_nodes.emplace_back();
+	m_nodes[0].first = 0;
+	m_nodes[0].count = (int)m_itemIndices.size();
+	updateNodeBounds(0);
+
+	// Depth first with an explicit stack, so that the depth is known for each node.
+	Array<std::pair<int, int>> stack; // Node index and depth.
+	stack.emplace_back(0, 1);
+	while (!stack.empty())
+	{
+		int nodeIndex = stack.back().first;
+		int depth = stack.back().second;
+		stack.pop_back();
+
+		m_depth = std::max(m_depth, depth);
+
+		// The traversal stack has room for MaxDepth nodes, so the deepest nodes stay leaves.
+		if (depth >= MaxDepth || !split(nodeIndex))
+			continue;
+
+		stack.emplace_back(m_nodes[nodeIndex].first, depth + 1);
+		stack.emplace_back(m_nodes[nodeIndex].first + 1, depth + 1);
+	}
+
+	// Only needed while building.
+	Array<Box>().swap(m_itemBounds);
+	Array<vec3>().swap(m_itemCentroids);
+}
+
+void FlatBvh::updateNodeBounds(int nodeIndex)
+{
+	FlatBvhNode& node = m_nodes[nodeIndex];
+	Box box;
+	for (int i = node.first; i < node.first + node.count; ++i)
+	{
+		box.grow(m_itemBounds[m_itemIndices[i]]);
+	}
+	node.min = box.min();
+	node.max = box.max();
+}
+
+bool FlatBvh::split(int nodeIndex)
+{
+	const int first = m_nodes[nodeIndex].first;
+	const int count = m_nodes[nodeIndex].count;
+
+	if (count <= 1)
+		return false;
+
+	Box centroidBounds;
+	for (int i = first; i < first + count; ++i)
+	{
+		centroidBounds.grow(m_itemCentroids[m_itemIndices[i]]);
+	}
+
+	struct Bin
+	{
+		Box bounds;
+		int count = 0;
+	};
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestSplit = 0;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float axisMin = centroidBounds.min()[axis];
+		const float axisExtent = centroidBounds.max()[axis] - axisMin;
+		if (axisExtent <= 0.0f)
+			continue;
+
+		const float binScale = float(BinCount) / axisExtent;
+
+		Bin bins[BinCount];
+		for (int i = first; i < first + count; ++i)
+		{
+			int itemIndex = m_itemIndices[i];
+			int binIndex = std::min(BinCount - 1, int((m_itemCentroids[itemIndex][axis] - axisMin) * binScale));
+			bins[binIndex].count++;
+			bins[binIndex].bounds.grow(m_itemBounds[itemIndex]);
+		}
+
+		// Sweep from both sides, so that each of the BinCount - 1 split planes is evaluated in constant time.
+		float leftAreas[BinCount - 1];
+		int leftCounts[BinCount - 1];
+		Box leftBox;
+		int leftCount = 0;
+		for (int i = 0; i < BinCount - 1; ++i)
+		{
+			leftCount += bins[i].count;
+			if (bins[i].count > 0)
+				leftBox.grow(bins[i].bounds);
+			leftCounts[i] = leftCount;
+			leftAreas[i] = halfArea(leftBox);
+		}
+
+		Box rightBox;
+		int rightCount = 0;
+		for (int i = BinCount - 1; i > 0; --i)
+		{
+			rightCount += bins[i].count;
+			if (bins[i].count > 0)
+				rightBox.grow(bins[i].bounds);
+
+			// Split between bins i - 1 and i.
+			float cost = itemCost(leftCounts[i - 1]) * leftAreas[i - 1] + itemCost(rightCount) * halfArea(rightBox);
+			if (leftCounts[i - 1] > 0 && rightCount > 0 && cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	// All the centroids are at the same point, so there's no plane to split them with.
+	if (bestAxis == -1)
+		return false;
+
+	const float leafCost = itemCost(count) * halfArea(Box(m_nodes[nodeIndex].min, m_nodes[nodeIndex].max));
+	if (count <= std::max(MaxLeafSize, m_batchSize) && bestCost >= leafCost)
+		return false;
+
+	const float axisMin = centroidBounds.min()[bestAxis];
+	const float binScale = float(BinCount) / (centroidBounds.max()[bestAxis] - axisMin);
+	auto middle = std::partition(m_itemIndices.begin() + first, m_itemIndices.begin() + first + count, [&](int itemIndex)
+	{
+		int binIndex = std::min(BinCount - 1, int((m_itemCentroids[itemIndex][bestAxis] - axisMin) * binScale));
+		return binIndex < bestSplit;
+	});
+
+	const int leftCount = int(middle - m_itemIndices.begin()) - first;
+	if (leftCount == 0 || leftCount == count)
+		return false;
+
+	const int leftIndex = (int)m_nodes.size();
+	m_nodes.emplace_back();
+	m_nodes.emplace_back();
+
+	m_nodes[leftIndex].first = first;
+	m_nodes[leftIndex].count = leftCount;
+	m_nodes[leftIndex + 1].first = first + leftCount;
+	m_nodes[leftIndex + 1].count = count - leftCount;
+	updateNodeBounds(leftIndex);
+	updateNodeBounds(leftIndex + 1);
+
+	m_nodes[nodeIndex].first = leftIndex;
+	m_nodes[nodeIndex].count = 0;
+	return true;
+}
+
+void FlatBvh::iterate(std::function<void(const Box&)> process) const
+{
+	for (auto&& node : m_nodes)
+	{
+		process(Box(node.min, node.max));
+	}
+}
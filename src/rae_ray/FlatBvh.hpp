@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+
+#include "rae/core/Types.hpp"
+#include "rae/visual/Box.hpp"
+#include "rae/visual/Ray.hpp"
+
+namespace rae
+{
+
+// A node of a FlatBvh. The two children of an inner node are next to each other in the node array,
+// so a node only needs to store the index of the first one. 32 bytes, so two nodes fit on a cache line.
+struct FlatBvhNode
+{
+	vec3	min;
+	int		first = 0; // Left child for inner nodes (right is first + 1), first item for leaves.
+	vec3	max;
+	int		count = 0; // Number of items in a leaf, 0 for inner nodes.
+
+	bool isLeaf() const { return count > 0; }
+};
+
+// Bounding volume hierarchy over a set of boxes, built with the binned surface area heuristic (SAH)
+// into a flat array of nodes. Unlike BvhNode, which has a Hitable for each item and a heap allocation
+// for each node, this only deals with item indices, and the hit testing of the items is left to the caller.
+// Usage example:
+// bvh.build(bounds);
+// bvh.traverse(ray, 0.001f, closestSoFar, [&](int itemIndex)
+// {
+//     if (hitItem(itemIndex, ray, closestSoFar, record))
+//         closestSoFar = record.t;
+// });
+class FlatBvh
+{
+public:
+	static const int BinCount = 12;
+	static const int MaxLeafSize = 4;
+	static const int MaxDepth = 64;
+
+	// The item indices given to traverse are indices to the bounds given here. If the caller tests the items of
+	// a leaf in batches, e.g. with SIMD, the batchSize lets the leaves grow to a whole batch, and the SAH counts
+	// the batches of a leaf instead of its items.
+	void build(const Array<Box>& bounds, int batchSize = 1);
+	void clear();
+
+	bool isEmpty() const { return m_nodes.empty(); }
+	const Array<FlatBvhNode>& nodes() const { return m_nodes; }
+	int depth() const { return m_depth; }
+
+	// Calls hitItem(int itemIndex) for the items whose boxes the ray hits between tMin and tMax.
+	// The nearer child is visited first, and the callback can lower tMax (usually through a captured reference
+	// to the same variable) to skip the nodes behind the closest hit so far.
+	template <typename Func>
+	void traverse(const Ray& ray, float tMin, const float& tMax, Func&& hitItem) const
+	{
+		traverseLeaves(ray, tMin, tMax, [&](int nodeIndex)
+		{
+			const FlatBvhNode& node = m_nodes[nodeIndex];
+			for (int i = node.first; i < node.first + node.count; ++i)
+			{
+				hitItem(m_itemIndices[i]);
+			}
+		});
+	}
+
+	// Like traverse, but calls hitLeaf(int nodeIndex) once for each leaf which the ray hits, so that the caller
+	// can test all the items of the leaf at once. The items of a leaf are leafItem(node, 0..node.count-1).
+	template <typename Func>
+	void traverseLeaves(const Ray& ray, float tMin, const float& tMax, Func&& hitLeaf) const
+	{
+		if (m_nodes.empty())
+			return;
+
+		const vec3 origin = ray.origin();
+		const vec3 invDirection = 1.0f / ray.direction();
+
+		float entry;
+		if (!hitNode(m_nodes[0], origin, invDirection, tMin, tMax, entry))
+			return;
+
+		int stackNodes[MaxDepth];
+		float stackEntries[MaxDepth];
+		int stackSize = 0;
+
+		int nodeIndex = 0;
+		while (true)
+		{
+			const FlatBvhNode& node = m_nodes[nodeIndex];
+			if (node.isLeaf())
+			{
+				hitLeaf(nodeIndex);
+			}
+			else
+			{
+				int nearIndex = node.first;
+				int farIndex = node.first + 1;
+				float nearEntry;
+				float farEntry;
+				bool hitNear = hitNode(m_nodes[nearIndex], origin, invDirection, tMin, tMax, nearEntry);
+				bool hitFar = hitNode(m_nodes[farIndex], origin, invDirection, tMin, tMax, farEntry);
+
+				if (hitNear && hitFar)
+				{
+					if (farEntry < nearEntry)
+					{
+						std::swap(nearIndex, farIndex);
+						std::swap(nearEntry, farEntry);
+					}
+					stackNodes[stackSize] = farIndex;
+					stackEntries[stackSize] = farEntry;
+					stackSize++;
+					nodeIndex = nearIndex;
+					continue;
+				}
+				else if (hitNear || hitFar)
+				{
+					nodeIndex = hitNear ? nearIndex : farIndex;
+					continue;
+				}
+			}
+
+			// Pop the next node, skipping the ones which start behind the closest hit found meanwhile.
+			nodeIndex = -1;
+			while (stackSize > 0)
+			{
+				stackSize--;
+				if (stackEntries[stackSize] <= tMax)
+				{
+					nodeIndex = stackNodes[stackSize];
+					break;
+				}
+			}
+
+			if (nodeIndex == -1)
+				break;
+		}
+	}
+
+	int leafItem(const FlatBvhNode& leaf, int i) const { return m_itemIndices[leaf.first + i]; }
+
+	// For debug drawing of the node boxes.
+	void iterate(std::function<void(const Box&)> process) const;
+
+protected:
+	static bool hitNode(const FlatBvhNode& node, const vec3& origin, const vec3& invDirection,
+		float tMin, float tMax, float& entry)
+	{
+		vec3 t0 = (node.min - origin) * invDirection;
+		vec3 t1 = (node.max - origin) * invDirection;
+		vec3 tNear = glm::min(t0, t1);
+		vec3 tFar = glm::max(t0, t1);
+		entry = std::max(tMin, std::max(tNear.x, std::max(tNear.y, tNear.z)));
+		float exit = std::min(tMax, std::min(tFar.x, std::min(tFar.y, tFar.z)));
+		return entry <= exit;
+	}
+
+	void updateNodeBounds(int nodeIndex);
+	// The cost of testing the items of a leaf, in batches.
+	float itemCost(int count) const { return float((count + m_batchSize - 1) / m_batchSize); }
+	// Returns false if the node should stay a leaf.
+	bool split(int nodeIndex);
+
+	Array<FlatBvhNode>	m_nodes;
+	Array<int>			m_itemIndices; // Item indices sorted so that each leaf has a contiguous range.
+	Array<Box>			m_itemBounds;
+	Array<vec3>			m_itemCentroids;
+	int					m_depth = 0;
+	int					m_batchSize = 1;
+};
+
+} // namespace rae
@@ -0,0 +1,108 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/FlatBvh.hpp"
+#include "rae/core/Random.hpp"
+
+using namespace rae;
+
+SCENARIO("FlatBvh unittest", "[rae][FlatBvh]")
+{
+	GIVEN( "a BVH over a few hundred random boxes" )
+	{
+		Array<Box> bounds;
+		for (int i = 0; i < 300; ++i)
+		{
+			vec3 center(getRandom(-20.0f, 20.0f), getRandom(-20.0f, 20.0f), getRandom(-20.0f, 20.0f));
+			vec3 halfSize(getRandom(0.1f, 1.0f), getRandom(0.1f, 1.0f), getRandom(0.1f, 1.0f));
+			bounds.emplace_back(center - halfSize, center + halfSize);
+		}
+		// Boxes on top of each other can't be split.
+		bounds.emplace_back(vec3(-1.0f), vec3(1.0f));
+		bounds.emplace_back(vec3(-1.0f), vec3(1.0f));
+		// Invalid bounds are left out.
+		bounds.emplace_back(Box());
+
+		FlatBvh bvh;
+		bvh.build(bounds);
+
+		THEN( "every item is in exactly one leaf" )
+		{
+			int leafItemCount = 0;
+			for (auto&& node : bvh.nodes())
+			{
+				leafItemCount += node.count;
+			}
+			REQUIRE(leafItemCount == (int)bounds.size() - 1);
+			REQUIRE(bvh.depth() < FlatBvh::MaxDepth);
+		}
+
+		THEN( "the traversal finds the same nearest box as a brute force search" )
+		{
+			for (int k = 0; k < 200; ++k)
+			{
+				vec3 origin(getRandom(-30.0f, 30.0f), getRandom(-30.0f, 30.0f), getRandom(-30.0f, 30.0f));
+				vec3 target(getRandom(-10.0f, 10.0f), getRandom(-10.0f, 10.0f), getRandom(-10.0f, 10.0f));
+				Ray ray(origin, target - origin);
+
+				// Use the entry distance of the box as the hit distance.
+				auto boxDistance = [&](int itemIndex, float tMax) -> float
+				{
+					const Box& box = bounds[itemIndex];
+					float entry = 0.0f;
+					for (int a = 0; a < 3; ++a)
+					{
+						float invD = 1.0f / ray.direction()[a];
+						float t0 = (box.min()[a] - ray.origin()[a]) * invD;
+						float t1 = (box.max()[a] - ray.origin()[a]) * invD;
+						if (invD < 0.0f)
+							std::swap(t0, t1);
+						entry = std::max(entry, t0);
+						tMax = std::min(tMax, t1);
+					}
+					return entry <= tMax ? entry : -1.0f;
+				};
+
+				float bruteForceClosest = FLT_MAX;
+				for (int i = 0; i < (int)bounds.size() - 1; ++i)
+				{
+					float t = boxDistance(i, bruteForceClosest);
+					if (t >= 0.0f && t < bruteForceClosest)
+						bruteForceClosest = t;
+				}
+
+				float closestSoFar = FLT_MAX;
+				int visitCount = 0;
+				bvh.traverse(ray, 0.0f, closestSoFar, [&](int itemIndex)
+				{
+					visitCount++;
+					float t = boxDistance(itemIndex, closestSoFar);
+					if (t >= 0.0f && t < closestSoFar)
+						closestSoFar = t;
+				});
+
+				REQUIRE(closestSoFar == bruteForceClosest);
+				REQUIRE(visitCount < (int)bounds.size());
+			}
+		}
+	}
+
+	GIVEN( "an empty BVH" )
+	{
+		FlatBvh bvh;
+		bvh.build(Array<Box>());
+
+		int visitCount = 0;
+		float closestSoFar = FLT_MAX;
+		bvh.traverse(Ray(vec3(0.0f), vec3(1.0f, 0.0f, 0.0f)), 0.0f, closestSoFar, [&](int itemIndex)
+		{
+			visitCount++;
+		});
+		REQUIRE(bvh.isEmpty());
+		REQUIRE(visitCount == 0);
+	}
+}
+
+#endif
@@ -0,0 +1,289 @@
+#include "rae_ray/HitKernels.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(RAE_SIMD_AVX) || defined(RAE_SIMD_SSE)
+	#include <immintrin.h>
+#endif
+
+using namespace rae;
+
+namespace
+{
+
+// Picks the lane with the smallest t out of the lanes in the hit mask.
+int closestLane(int hitMask, const float* t, float& outT)
+{
+	int closest = -1;
+	for (int i = 0; i < HitBatchWidth; ++i)
+	{
+		if ((hitMask & (1 << i)) && (closest == -1 || t[i] < t[closest]))
+			closest = i;
+	}
+
+	if (closest != -1)
+		outT = t[closest];
+	return closest;
+}
+
+}
+
+bool rae::isSimdAvailable()
+{
+#if defined(RAE_SIMD_AVX) || defined(RAE_SIMD_SSE)
+	return true;
+#else
+	return false;
+#endif
+}
+
+const char* rae::simdName()
+{
+#if defined(RAE_SIMD_AVX)
+	return "AVX";
+#elif defined(RAE_SIMD_SSE)
+	return "SSE";
+#else
+	return "Scalar";
+#endif
+}
+
+void SphereBatch::add(const vec3& center, float radius)
+{
+	assert(count < HitBatchWidth);
+	centerX[count] = center.x;
+	centerY[count] = center.y;
+	centerZ[count] = center.z;
+	this->radius[count] = radius;
+	count++;
+}
+
+void BoxBatch::add(const vec3& min, const vec3& max)
+{
+	assert(count < HitBatchWidth);
+	minX[count] = min.x;
+	minY[count] = min.y;
+	minZ[count] = min.z;
+	maxX[count] = max.x;
+	maxY[count] = max.y;
+	maxZ[count] = max.z;
+	count++;
+}
+
+// The scalar versions do the same operations in the same order as the SIMD ones, so that both give the same
+// results, and the SIMD ones can be tested against them.
+
+int rae::hitSpheresScalar(const SphereBatch& batch, const vec3& origin, const vec3& direction,
+	float tMin, float tMax, float& outT)
+{
+	const float a = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;
+
+	int hitMask = 0;
+	float t[HitBatchWidth];
+	for (int i = 0; i < batch.count; ++i)
+	{
+		float ocX = origin.x - batch.centerX[i];
+		float ocY = origin.y - batch.centerY[i];
+		float ocZ = origin.z - batch.centerZ[i];
+		float b = ocX * direction.x + ocY * direction.y + ocZ * direction.z;
+		float c = ocX * ocX + ocY * ocY + ocZ * ocZ - batch.radius[i] * batch.radius[i];
+		float discriminant = b * b - a * c;
+		if (discriminant > 0.0f)
+		{
+			t[i] = (-b - std::sqrt(discriminant)) / a;
+			if (t[i] > tMin && t[i] < tMax)
+				hitMask |= 1 << i;
+		}
+	}
+	return closestLane(hitMask, t, outT);
+}
+
+int rae::hitBoxesScalar(const BoxBatch& batch, const vec3& origin, const vec3& invDirection,
+	float tMin, float tMax, float* outEntries)
+{
+	int hitMask = 0;
+	for (int i = 0; i < batch.count; ++i)
+	{
+		float t0X = (batch.minX[i] - origin.x) * invDirection.x;
+		float t0Y = (batch.minY[i] - origin.y) * invDirection.y;
+		float t0Z = (batch.minZ[i] - origin.z) * invDirection.z;
+		float t1X = (batch.maxX[i] - origin.x) * invDirection.x;
+		float t1Y = (batch.maxY[i] - origin.y) * invDirection.y;
+		float t1Z = (batch.maxZ[i] - origin.z) * invDirection.z;
+		float entry = std::max(std::max(std::min(t0X, t1X), std::min(t0Y, t1Y)), std::min(t0Z, t1Z));
+		float exit = std::min(std::min(std::max(t0X, t1X), std::max(t0Y, t1Y)), std::max(t0Z, t1Z));
+		entry = std::max(entry, tMin);
+		exit = std::min(exit, tMax);
+		outEntries[i] = entry;
+		if (entry <= exit)
+			hitMask |= 1 << i;
+	}
+	return hitMask;
+}
+
+#if defined(RAE_SIMD_AVX)
+
+int rae::hitSpheres(const SphereBatch& batch, const vec3& origin, const vec3& direction,
+	float tMin, float tMax, float& outT)
+{
+	const float a = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;
+
+	const __m256 dirX = _mm256_set1_ps(direction.x);
+	const __m256 dirY = _mm256_set1_ps(direction.y);
+	const __m256 dirZ = _mm256_set1_ps(direction.z);
+
+	__m256 ocX = _mm256_sub_ps(_mm256_set1_ps(origin.x), _mm256_loadu_ps(batch.centerX));
+	__m256 ocY = _mm256_sub_ps(_mm256_set1_ps(origin.y), _mm256_loadu_ps(batch.centerY));
+	__m256 ocZ = _mm256_sub_ps(_mm256_set1_ps(origin.z), _mm256_loadu_ps(batch.centerZ));
+	__m256 radius = _mm256_loadu_ps(batch.radius);
+
+	__m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocX, dirX), _mm256_mul_ps(ocY, dirY)),
+		_mm256_mul_ps(ocZ, dirZ));
+	__m256 c = _mm256_sub_ps(
+		_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocX, ocX), _mm256_mul_ps(ocY, ocY)), _mm256_mul_ps(ocZ, ocZ)),
+		_mm256_mul_ps(radius, radius));
+	__m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(_mm256_set1_ps(a), c));
+
+	// Most rays miss all the spheres of a leaf, so the square roots are skipped then.
+	__m256 mask = _mm256_cmp_ps(discriminant, _mm256_setzero_ps(), _CMP_GT_OQ);
+	if (_mm256_movemask_ps(mask) == 0)
+		return -1;
+
+	// The lanes with a negative discriminant get a NaN t, but they're masked out anyway.
+	__m256 t = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), b), _mm256_sqrt_ps(discriminant)),
+		_mm256_set1_ps(a));
+
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, _mm256_set1_ps(tMin), _CMP_GT_OQ));
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, _mm256_set1_ps(tMax), _CMP_LT_OQ));
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0),
+		_mm256_set1_ps(float(batch.count)), _CMP_LT_OQ));
+
+	const int hitMask = _mm256_movemask_ps(mask);
+	if (hitMask == 0)
+		return -1;
+
+	float lanes[HitBatchWidth];
+	_mm256_storeu_ps(lanes, t);
+	return closestLane(hitMask, lanes, outT);
+}
+
+int rae::hitBoxes(const BoxBatch& batch, const vec3& origin, const vec3& invDirection,
+	float tMin, float tMax, float* outEntries)
+{
+	const __m256 originX = _mm256_set1_ps(origin.x);
+	const __m256 originY = _mm256_set1_ps(origin.y);
+	const __m256 originZ = _mm256_set1_ps(origin.z);
+	const __m256 invDirX = _mm256_set1_ps(invDirection.x);
+	const __m256 invDirY = _mm256_set1_ps(invDirection.y);
+	const __m256 invDirZ = _mm256_set1_ps(invDirection.z);
+
+	__m256 t0X = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(batch.minX), originX), invDirX);
+	__m256 t0Y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(batch.minY), originY), invDirY);
+	__m256 t0Z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(batch.minZ), originZ), invDirZ);
+	__m256 t1X = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(batch.maxX), originX), invDirX);
+	__m256 t1Y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(batch.maxY), originY), invDirY);
+	__m256 t1Z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(batch.maxZ), originZ), invDirZ);
+
+	__m256 entry = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t0X, t1X), _mm256_min_ps(t0Y, t1Y)),
+		_mm256_min_ps(t0Z, t1Z));
+	__m256 exit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t0X, t1X), _mm256_max_ps(t0Y, t1Y)),
+		_mm256_max_ps(t0Z, t1Z));
+	entry = _mm256_max_ps(entry, _mm256_set1_ps(tMin));
+	exit = _mm256_min_ps(exit, _mm256_set1_ps(tMax));
+
+	__m256 mask = _mm256_cmp_ps(entry, exit, _CMP_LE_OQ);
+	mask = _mm256_and_ps(mask, _mm256_cmp_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0),
+		_mm256_set1_ps(float(batch.count)), _CMP_LT_OQ));
+
+	_mm256_storeu_ps(outEntries, entry);
+	return _mm256_movemask_ps(mask);
+}
+
+#elif defined(RAE_SIMD_SSE)
+
+int rae::hitSpheres(const SphereBatch& batch, const vec3& origin, const vec3& direction,
+	float tMin, float tMax, float& outT)
+{
+	const float a = direction.x * direction.x + direction.y * direction.y + direction.z * direction.z;
+
+	const __m128 dirX = _mm_set1_ps(direction.x);
+	const __m128 dirY = _mm_set1_ps(direction.y);
+	const __m128 dirZ = _mm_set1_ps(direction.z);
+
+	__m128 ocX = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_loadu_ps(batch.centerX));
+	__m128 ocY = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_loadu_ps(batch.centerY));
+	__m128 ocZ = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_loadu_ps(batch.centerZ));
+	__m128 radius = _mm_loadu_ps(batch.radius);
+
+	__m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocX, dirX), _mm_mul_ps(ocY, dirY)), _mm_mul_ps(ocZ, dirZ));
+	__m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocX, ocX), _mm_mul_ps(ocY, ocY)), _mm_mul_ps(ocZ, ocZ)),
+		_mm_mul_ps(radius, radius));
+	__m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(_mm_set1_ps(a), c));
+
+	// Most rays miss all the spheres of a leaf, so the square roots are skipped then.
+	__m128 mask = _mm_cmpgt_ps(discriminant, _mm_setzero_ps());
+	if (_mm_movemask_ps(mask) == 0)
+		return -1;
+
+	// The lanes with a negative discriminant get a NaN t, but they're masked out anyway.
+	__m128 t = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), b), _mm_sqrt_ps(discriminant)), _mm_set1_ps(a));
+
+	mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, _mm_set1_ps(tMin)));
+	mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(tMax)));
+	mask = _mm_and_ps(mask, _mm_cmplt_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(float(batch.count))));
+
+	const int hitMask = _mm_movemask_ps(mask);
+	if (hitMask == 0)
+		return -1;
+
+	float lanes[HitBatchWidth];
+	_mm_storeu_ps(lanes, t);
+	return closestLane(hitMask, lanes, outT);
+}
+
+int rae::hitBoxes(const BoxBatch& batch, const vec3& origin, const vec3& invDirection,
+	float tMin, float tMax, float* outEntries)
+{
+	const __m128 originX = _mm_set1_ps(origin.x);
+	const __m128 originY = _mm_set1_ps(origin.y);
+	const __m128 originZ = _mm_set1_ps(origin.z);
+	const __m128 invDirX = _mm_set1_ps(invDirection.x);
+	const __m128 invDirY = _mm_set1_ps(invDirection.y);
+	const __m128 invDirZ = _mm_set1_ps(invDirection.z);
+
+	__m128 t0X = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(batch.minX), originX), invDirX);
+	__m128 t0Y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(batch.minY), originY), invDirY);
+	__m128 t0Z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(batch.minZ), originZ), invDirZ);
+	__m128 t1X = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(batch.maxX), originX), invDirX);
+	__m128 t1Y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(batch.maxY), originY), invDirY);
+	__m128 t1Z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(batch.maxZ), originZ), invDirZ);
+
+	__m128 entry = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0X, t1X), _mm_min_ps(t0Y, t1Y)), _mm_min_ps(t0Z, t1Z));
+	__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0X, t1X), _mm_max_ps(t0Y, t1Y)), _mm_max_ps(t0Z, t1Z));
+	entry = _mm_max_ps(entry, _mm_set1_ps(tMin));
+	exit = _mm_min_ps(exit, _mm_set1_ps(tMax));
+
+	__m128 mask = _mm_cmple_ps(entry, exit);
+	mask = _mm_and_ps(mask, _mm_cmplt_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(float(batch.count))));
+
+	_mm_storeu_ps(outEntries, entry);
+	return _mm_movemask_ps(mask);
+}
+
+#else
+
+int rae::hitSpheres(const SphereBatch& batch, const vec3& origin, const vec3& direction,
+	float tMin, float tMax, float& outT)
+{
+	return hitSpheresScalar(batch, origin, direction, tMin, tMax, outT);
+}
+
+int rae::hitBoxes(const BoxBatch& batch, const vec3& origin, const vec3& invDirection,
+	float tMin, float tMax, float* outEntries)
+{
+	return hitBoxesScalar(batch, origin, invDirection, tMin, tMax, outEntries);
+}
+
+#endif
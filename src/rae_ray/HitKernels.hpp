@@ -0,0 +1,69 @@
+#pragma once
+
+#include "rae/core/Types.hpp"
+
+// The widest instruction set of the compiler flags is picked at compile time. SSE2 is always there on x64,
+// and AVX is used when building with e.g. -mavx2 or -march=native. Without either, the kernels are scalar loops.
+#if defined(__AVX__)
+	#define RAE_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define RAE_SIMD_SSE
+#endif
+
+namespace rae
+{
+
+// The number of lanes in a batch, i.e. how many spheres or boxes one ray is tested against at once.
+#if defined(RAE_SIMD_AVX)
+const int HitBatchWidth = 8;
+#else
+const int HitBatchWidth = 4;
+#endif
+
+// True if the kernels use SSE or AVX, and false if they fall back to the scalar versions.
+bool isSimdAvailable();
+// "AVX", "SSE" or "Scalar", for logging.
+const char* simdName();
+
+// Spheres in structure of arrays layout, so that one lane of each array is one sphere. The count tells how many
+// of the lanes are in use, and the rest are never hit.
+struct SphereBatch
+{
+	float centerX[HitBatchWidth] = {};
+	float centerY[HitBatchWidth] = {};
+	float centerZ[HitBatchWidth] = {};
+	float radius[HitBatchWidth] = {};
+	int count = 0;
+
+	void add(const vec3& center, float radius);
+};
+
+// Axis aligned boxes in structure of arrays layout, like SphereBatch.
+struct BoxBatch
+{
+	float minX[HitBatchWidth] = {};
+	float minY[HitBatchWidth] = {};
+	float minZ[HitBatchWidth] = {};
+	float maxX[HitBatchWidth] = {};
+	float maxY[HitBatchWidth] = {};
+	float maxZ[HitBatchWidth] = {};
+	int count = 0;
+
+	void add(const vec3& min, const vec3& max);
+};
+
+// Finds the closest sphere which the ray enters between tMin and tMax. Returns the lane of the sphere and writes
+// the t of the hit, or returns -1. Like the hitSphere of the Hitables, only the nearer root is considered.
+int hitSpheres(const SphereBatch& batch, const vec3& origin, const vec3& direction,
+	float tMin, float tMax, float& outT);
+int hitSpheresScalar(const SphereBatch& batch, const vec3& origin, const vec3& direction,
+	float tMin, float tMax, float& outT);
+
+// Tests the ray against all the boxes with the slab test. Returns a bit mask of the lanes whose boxes the ray
+// hits between tMin and tMax, and writes the entry distances of the lanes to outEntries.
+int hitBoxes(const BoxBatch& batch, const vec3& origin, const vec3& invDirection,
+	float tMin, float tMax, float* outEntries);
+int hitBoxesScalar(const BoxBatch& batch, const vec3& origin, const vec3& invDirection,
+	float tMin, float tMax, float* outEntries);
+
+} // namespace rae
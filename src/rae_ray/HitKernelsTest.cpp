@@ -0,0 +1,237 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/HitKernels.hpp"
+#include "rae_ray/RenderScene.hpp"
+#include "rae/core/Random.hpp"
+
+#include "loguru/loguru.hpp"
+
+#include <chrono>
+#include <functional>
+
+using namespace rae;
+
+namespace
+{
+
+// The final scene of Ray Tracing in One Weekend, like the old RayTracer::createSceneFromBook:
+// a big ground sphere, a grid of about 500 small ones, and three big ones.
+void createSceneFromBook(RenderScene& scene)
+{
+	int material = scene.addMaterial(Material("Default", Color3(0.5f, 0.5f, 0.5f)));
+
+	Id id = 1; // 0 is the InvalidId.
+	scene.addSphere(id++, vec3(0.0f, -1000.0f, 0.0f), 1000.0f, material);
+	for (int a = -11; a < 11; ++a)
+	{
+		for (int b = -11; b < 11; ++b)
+		{
+			vec3 center(a + 0.9f * getRandom(), 0.2f, b + 0.9f * getRandom());
+			if (glm::length(center - vec3(4.0f, 0.2f, 0.0f)) > 0.9f)
+				scene.addSphere(id++, center, 0.2f, material);
+		}
+	}
+	scene.addSphere(id++, vec3(0.0f, 1.0f, 0.0f), 1.0f, material);
+	scene.addSphere(id++, vec3(-4.0f, 1.0f, 0.0f), 1.0f, material);
+	scene.addSphere(id++, vec3(4.0f, 1.0f, 0.0f), 1.0f, material);
+	scene.buildBvh();
+}
+
+// From the camera position of the book towards the origin, spread over roughly the field of view.
+Ray randomCameraRay()
+{
+	const vec3 origin(13.0f, 2.0f, 3.0f);
+	vec3 target(getRandom(-8.0f, 8.0f), getRandom(-1.0f, 4.0f), getRandom(-8.0f, 8.0f));
+	return Ray(origin, glm::normalize(target - origin));
+}
+
+}
+
+SCENARIO("HitKernels unittest", "[rae][HitKernels]")
+{
+	GIVEN( "a batch with spheres in all but the last lane" )
+	{
+		SphereBatch batch;
+		for (int i = 0; i < HitBatchWidth - 1; ++i)
+		{
+			batch.add(vec3(0.0f, 0.0f, -10.0f - 2.0f * float(i)), 0.5f);
+		}
+
+		const vec3 origin(0.0f, 0.0f, 0.0f);
+		const vec3 direction(0.0f, 0.0f, -1.0f);
+
+		THEN( "the nearest sphere is hit with both the SIMD and the scalar kernel" )
+		{
+			float t = 0.0f;
+			float scalarT = 0.0f;
+			REQUIRE( hitSpheres(batch, origin, direction, 0.001f, FLT_MAX, t) == 0 );
+			REQUIRE( hitSpheresScalar(batch, origin, direction, 0.001f, FLT_MAX, scalarT) == 0 );
+			REQUIRE( t == Approx(9.5f) );
+			REQUIRE( scalarT == t );
+		}
+
+		THEN( "the spheres before tMin and after tMax are skipped" )
+		{
+			float t = 0.0f;
+			REQUIRE( hitSpheres(batch, origin, direction, 10.0f, FLT_MAX, t) == 1 );
+			REQUIRE( t == Approx(11.5f) );
+			REQUIRE( hitSpheres(batch, origin, direction, 0.001f, 9.0f, t) == -1 );
+		}
+
+		THEN( "the unused lane is never hit" )
+		{
+			// A sphere which would be the nearest one, if the lane was in use.
+			batch.centerZ[HitBatchWidth - 1] = -4.0f;
+			batch.radius[HitBatchWidth - 1] = 1.0f;
+
+			float t = 0.0f;
+			REQUIRE( hitSpheres(batch, origin, direction, 0.001f, FLT_MAX, t) == 0 );
+			REQUIRE( hitSpheresScalar(batch, origin, direction, 0.001f, FLT_MAX, t) == 0 );
+		}
+	}
+
+	GIVEN( "a batch of boxes" )
+	{
+		BoxBatch batch;
+		batch.add(vec3(-1.0f, -1.0f, -6.0f), vec3(1.0f, 1.0f, -4.0f));
+		batch.add(vec3(3.0f, -1.0f, -6.0f), vec3(5.0f, 1.0f, -4.0f));
+		batch.add(vec3(-1.0f, -1.0f, -3.0f), vec3(1.0f, 1.0f, -2.0f));
+
+		const vec3 origin(0.0f, 0.0f, 0.0f);
+		const vec3 invDirection = 1.0f / vec3(0.0f, 0.0f, -1.0f);
+
+		THEN( "the boxes in front of the ray are hit, with their entry distances" )
+		{
+			float entries[HitBatchWidth];
+			REQUIRE( hitBoxes(batch, origin, invDirection, 0.001f, FLT_MAX, entries) == 0x5 );
+			REQUIRE( entries[0] == Approx(4.0f) );
+			REQUIRE( entries[2] == Approx(2.0f) );
+
+			float scalarEntries[HitBatchWidth];
+			REQUIRE( hitBoxesScalar(batch, origin, invDirection, 0.001f, FLT_MAX, scalarEntries) == 0x5 );
+			REQUIRE( scalarEntries[0] == entries[0] );
+		}
+
+		THEN( "tMax culls the far box" )
+		{
+			float entries[HitBatchWidth];
+			REQUIRE( hitBoxes(batch, origin, invDirection, 0.001f, 3.0f, entries) == 0x4 );
+		}
+	}
+
+	GIVEN( "the scene of the book" )
+	{
+		RenderScene scene;
+		createSceneFromBook(scene);
+
+		THEN( "the SIMD kernels find the same hits as the scalar ones" )
+		{
+			int mismatches = 0;
+			for (int i = 0; i < 1000; ++i)
+			{
+				Ray ray = randomCameraRay();
+
+				int primitive = -1;
+				HitRecord record;
+				scene.setSimd(true);
+				bool isHit = scene.hit(ray, 0.001f, FLT_MAX, primitive, record);
+
+				int scalarPrimitive = -1;
+				HitRecord scalarRecord;
+				scene.setSimd(false);
+				bool isScalarHit = scene.hit(ray, 0.001f, FLT_MAX, scalarPrimitive, scalarRecord);
+
+				if (isHit != isScalarHit || primitive != scalarPrimitive)
+					mismatches++;
+			}
+			REQUIRE( mismatches == 0 );
+		}
+	}
+}
+
+// Hidden from the default test run. Run with: ./pihlaja "[benchmark]"
+SCENARIO("HitKernels benchmark", "[.][benchmark][HitKernels]")
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	const int RayCount = 200000;
+
+	RenderScene scene;
+	createSceneFromBook(scene);
+
+	Array<Ray> rays;
+	rays.reserve(RayCount);
+	for (int i = 0; i < RayCount; ++i)
+	{
+		rays.emplace_back(randomCameraRay());
+	}
+
+	auto measure = [&](const char* name, std::function<bool(const Ray&)> hit) -> double
+	{
+		int hitCount = 0;
+		auto start = Clock::now();
+		for (const Ray& ray : rays)
+		{
+			if (hit(ray))
+				hitCount++;
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		double raysPerSecond = double(RayCount) / seconds;
+		LOG_F(INFO, "%s: %f Mrays/s (%i hits)", name, raysPerSecond / 1000000.0, hitCount);
+		return raysPerSecond;
+	};
+
+	LOG_F(INFO, "%i spheres in the book scene, %s kernels.", scene.primitiveCount(), simdName());
+
+	// Through the BVH, where the kernels test the leaves.
+	auto hitScene = [&](const Ray& ray)
+	{
+		int primitive;
+		HitRecord record;
+		return scene.hit(ray, 0.001f, FLT_MAX, primitive, record);
+	};
+	scene.setSimd(false);
+	double scalar = measure("BVH with scalar leaves", hitScene);
+	scene.setSimd(true);
+	double simd = measure("BVH with SIMD leaves", hitScene);
+	LOG_F(INFO, "BVH speedup: %f", simd / scalar);
+
+	// All the spheres in batches without the BVH, which shows the speed of the kernels themselves.
+	Array<SphereBatch> batches(1);
+	for (int i = 0; i < scene.primitiveCount(); ++i)
+	{
+		if (batches.back().count == HitBatchWidth)
+			batches.emplace_back();
+		batches.back().add(scene.primitive(i).sphereCenter(), scene.primitive(i).sphere.radius);
+	}
+
+	auto bruteForce = [&](bool isSimd)
+	{
+		return [&batches, isSimd](const Ray& ray)
+		{
+			float closestSoFar = FLT_MAX;
+			bool isHit = false;
+			for (const SphereBatch& batch : batches)
+			{
+				float t;
+				int lane = isSimd
+					? hitSpheres(batch, ray.origin(), ray.direction(), 0.001f, closestSoFar, t)
+					: hitSpheresScalar(batch, ray.origin(), ray.direction(), 0.001f, closestSoFar, t);
+				if (lane != -1)
+				{
+					closestSoFar = t;
+					isHit = true;
+				}
+			}
+			return isHit;
+		};
+	};
+	scalar = measure("All spheres scalar", bruteForce(false));
+	simd = measure("All spheres SIMD", bruteForce(true));
+	LOG_F(INFO, "Kernel speedup: %f", simd / scalar);
+}
+
+#endif
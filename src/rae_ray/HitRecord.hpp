@@ -11,7 +11,7 @@ struct HitRecord
 	float t;
 	vec3 point;
 	vec3 normal;
-	Material* material = nullptr;
+	const Material* material = nullptr;
 };
 
 }
@@ -0,0 +1,127 @@
+#include "rae_ray/LightList.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "rae/core/Math.hpp"
+
+using namespace rae;
+
+namespace
+{
+
+float luminance(const vec3& color)
+{
+	return 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
+}
+
+// 1 - cos of the half angle of the cone which the sphere covers, or 0 if the point is inside it.
+// Computed from the sine, as the cosine is too close to 1 for small or far away lights.
+float coneOneMinusCos(float radius, float distanceSquared)
+{
+	float sinSquared = (radius * radius) / distanceSquared;
+	if (sinSquared >= 1.0f)
+		return 0.0f;
+	return sinSquared / (1.0f + std::sqrt(1.0f - sinSquared));
+}
+
+}
+
+void LightList::clear()
+{
+	m_lights.clear();
+	m_cdf.clear();
+	m_indices.clear();
+}
+
+void LightList::addSphere(Id id, const vec3& position, float radius, const vec3& emitted)
+{
+	m_indices[id] = (int)m_lights.size();
+
+	SphereLight light;
+	light.id = id;
+	light.position = position;
+	light.radius = radius;
+	light.emitted = emitted;
+	m_lights.emplace_back(light);
+}
+
+void LightList::finalize()
+{
+	// The power of a sphere light is proportional to its radiance times its surface area.
+	m_cdf.resize(m_lights.size());
+	float total = 0.0f;
+	for (int i = 0; i < (int)m_lights.size(); ++i)
+	{
+		total += luminance(m_lights[i].emitted) * m_lights[i].radius * m_lights[i].radius;
+		m_cdf[i] = total;
+	}
+
+	for (int i = 0; i < (int)m_cdf.size(); ++i)
+	{
+		// Without any power the lights are chosen uniformly.
+		m_cdf[i] = (total > 0.0f) ? m_cdf[i] / total : float(i + 1) / float(m_cdf.size());
+	}
+
+	if (!m_cdf.empty())
+		m_cdf.back() = 1.0f;
+}
+
+int LightList::findLight(Id id) const
+{
+	auto found = m_indices.find(id);
+	return (found != m_indices.end()) ? found->second : -1;
+}
+
+float LightList::choiceProbability(int lightIndex) const
+{
+	return m_cdf[lightIndex] - (lightIndex > 0 ? m_cdf[lightIndex - 1] : 0.0f);
+}
+
+float LightList::conePdf(const SphereLight& light, const vec3& point)
+{
+	vec3 toLight = light.position - point;
+	float oneMinusCos = coneOneMinusCos(light.radius, glm::dot(toLight, toLight));
+	if (oneMinusCos <= 0.0f)
+		return 0.0f;
+	return 1.0f / (Math::Tau * oneMinusCos);
+}
+
+bool LightList::sample(const vec3& point, float choiceSample, const vec2& directionSample, LightSample& outSample) const
+{
+	if (m_lights.empty())
+		return false;
+
+	const int lightIndex = std::min(
+		int(std::upper_bound(m_cdf.begin(), m_cdf.end(), choiceSample) - m_cdf.begin()),
+		(int)m_lights.size() - 1);
+	const SphereLight& light = m_lights[lightIndex];
+
+	vec3 toLight = light.position - point;
+	float distanceSquared = glm::dot(toLight, toLight);
+	float oneMinusCosMax = coneOneMinusCos(light.radius, distanceSquared);
+	if (oneMinusCosMax <= 0.0f)
+		return false;
+
+	// Uniform in the cone around the direction to the centre of the light.
+	float oneMinusCos = directionSample.x * oneMinusCosMax;
+	float cosTheta = 1.0f - oneMinusCos;
+	float sinTheta = std::sqrt(std::max(0.0f, oneMinusCos * (2.0f - oneMinusCos)));
+	float phi = Math::Tau * directionSample.y;
+
+	vec3 w = toLight / std::sqrt(distanceSquared);
+	vec3 helper = (std::abs(w.x) > 0.9f) ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f);
+	vec3 u = glm::normalize(glm::cross(helper, w));
+	vec3 v = glm::cross(w, u);
+
+	outSample.lightIndex = lightIndex;
+	outSample.direction = glm::normalize(u * (std::cos(phi) * sinTheta) + v * (std::sin(phi) * sinTheta) + w * cosTheta);
+	outSample.emitted = light.emitted;
+	outSample.pdf = choiceProbability(lightIndex) / (Math::Tau * oneMinusCosMax);
+	return true;
+}
+
+float LightList::pdf(int lightIndex, const vec3& point) const
+{
+	return choiceProbability(lightIndex) * conePdf(m_lights[lightIndex], point);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "rae/core/Types.hpp"
+
+namespace rae
+{
+
+// A direction towards a light, from the point which is being lit.
+struct LightSample
+{
+	int lightIndex = -1;
+	vec3 direction; // Normalized.
+	vec3 emitted;
+	float pdf = 0.0f; // Per solid angle, including the probability of choosing the light.
+};
+
+// The power heuristic with beta 2 (Veach 1997) for multiple importance sampling: the weight of a sample taken with
+// the first pdf, when the same direction could also have been sampled with the second one.
+inline float powerHeuristic(float pdf, float otherPdf)
+{
+	float square = pdf * pdf;
+	float otherSquare = otherPdf * otherPdf;
+	return (square + otherSquare > 0.0f) ? square / (square + otherSquare) : 0.0f;
+}
+
+// The emissive spheres of the scene, for next event estimation: the diffuse surfaces sample a direction towards
+// one of the lights and trace a shadow ray, instead of waiting for a scattered ray to hit a light by chance.
+// The lights are chosen in proportion to their power, and the direction uniformly in the cone which the sphere covers.
+// Usage example:
+// lights.clear();
+// lights.addSphere(id, position, radius, emitted); // For each light.
+// lights.finalize();
+// lights.sample(point, choiceSample, directionSample, lightSample);
+class LightList
+{
+public:
+	void clear();
+	void addSphere(Id id, const vec3& position, float radius, const vec3& emitted);
+	// Builds the distribution for choosing the lights. Call after adding them.
+	void finalize();
+
+	bool isEmpty() const { return m_lights.empty(); }
+	int lightCount() const { return (int)m_lights.size(); }
+	Id lightId(int lightIndex) const { return m_lights[lightIndex].id; }
+	// The index of the light of the entity, or -1 if the entity is not in the list.
+	int findLight(Id id) const;
+
+	// Chooses a light with the choiceSample, and a direction towards it with the directionSample.
+	// Returns false if there's no light to sample from the point, e.g. when the point is inside the only light.
+	bool sample(const vec3& point, float choiceSample, const vec2& directionSample, LightSample& outSample) const;
+	// The pdf of sample() giving a direction towards the light from the point.
+	float pdf(int lightIndex, const vec3& point) const;
+
+	// The probability of choosing the light.
+	float choiceProbability(int lightIndex) const;
+
+protected:
+	struct SphereLight
+	{
+		Id id;
+		vec3 position;
+		float radius;
+		vec3 emitted;
+	};
+
+	// The solid angle pdf of the directions in the cone of the light, or 0 if the point is inside the light.
+	static float conePdf(const SphereLight& light, const vec3& point);
+
+	Array<SphereLight> m_lights;
+	Array<float> m_cdf; // The cumulative probabilities of choosing the lights, ending at 1.
+	Map<Id, int> m_indices;
+};
+
+} // namespace rae
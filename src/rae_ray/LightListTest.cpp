@@ -0,0 +1,134 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include <cmath>
+
+#include "rae_ray/LightList.hpp"
+#include "rae/core/Math.hpp"
+#include "rae/core/Random.hpp"
+
+using namespace rae;
+
+namespace
+{
+
+bool hitsSphere(const vec3& origin, const vec3& direction, const vec3& center, float radius)
+{
+	vec3 oc = origin - center;
+	float b = glm::dot(oc, direction);
+	float c = glm::dot(oc, oc) - radius * radius;
+	return b < 0.0f && b * b - c >= 0.0f;
+}
+
+// A cosine distributed direction around +y, like the diffuse scattering.
+vec3 sampleCosineHemisphere(float u, float v)
+{
+	float radius = std::sqrt(u);
+	float angle = Math::Tau * v;
+	return vec3(radius * std::cos(angle), std::sqrt(std::max(0.0f, 1.0f - u)), radius * std::sin(angle));
+}
+
+}
+
+SCENARIO("LightList unittest", "[rae][LightList]")
+{
+	GIVEN( "a small bright light and a big dim light" )
+	{
+		LightList lights;
+		lights.addSphere(5, vec3(0.0f, 4.0f, 0.0f), 0.5f, vec3(16.0f));
+		lights.addSphere(7, vec3(3.0f, 2.0f, 0.0f), 2.0f, vec3(1.0f));
+		lights.finalize();
+
+		THEN( "the lights are found by their ids" )
+		{
+			REQUIRE( lights.lightCount() == 2 );
+			REQUIRE( lights.findLight(5) == 0 );
+			REQUIRE( lights.findLight(7) == 1 );
+			REQUIRE( lights.findLight(6) == -1 );
+		}
+
+		THEN( "the lights are chosen in proportion to their power" )
+		{
+			// 16 * 0.5^2 = 4 and 1 * 2^2 = 4.
+			REQUIRE( lights.choiceProbability(0) == Approx(0.5f) );
+			REQUIRE( lights.choiceProbability(1) == Approx(0.5f) );
+		}
+
+		THEN( "the sampled directions hit the chosen light, with the pdf of the light" )
+		{
+			const vec3 point = vec3(0.0f, 0.0f, 0.0f);
+			Pcg32 random(3);
+			int missCount = 0;
+			int pdfMismatchCount = 0;
+			for (int i = 0; i < 1000; ++i)
+			{
+				LightSample sample;
+				REQUIRE( lights.sample(point, random.nextFloat(), vec2(random.nextFloat(), random.nextFloat()), sample) );
+				const vec3 center = (sample.lightIndex == 0) ? vec3(0.0f, 4.0f, 0.0f) : vec3(3.0f, 2.0f, 0.0f);
+				const float radius = (sample.lightIndex == 0) ? 0.5f : 2.0f;
+				if (!hitsSphere(point, sample.direction, center, radius))
+					missCount++;
+				if (std::abs(sample.pdf - lights.pdf(sample.lightIndex, point)) > 1e-3f * sample.pdf)
+					pdfMismatchCount++;
+			}
+			REQUIRE( missCount == 0 );
+			REQUIRE( pdfMismatchCount == 0 );
+		}
+
+		THEN( "a point inside a light can't sample it" )
+		{
+			REQUIRE( lights.pdf(1, vec3(3.0f, 2.5f, 0.0f)) == 0.0f );
+		}
+	}
+
+	GIVEN( "a light above a white diffuse surface" )
+	{
+		const float radius = 1.0f;
+		const float distance = 3.0f;
+		const float emitted = 2.0f;
+		const vec3 normal = vec3(0.0f, 1.0f, 0.0f);
+		const vec3 center = vec3(0.0f, distance, 0.0f);
+
+		LightList lights;
+		lights.addSphere(1, center, radius, vec3(emitted));
+		lights.finalize();
+
+		// The reflected radiance of a white diffuse surface under a sphere is L * sin^2 of the half angle.
+		const float expected = emitted * (radius * radius) / (distance * distance);
+
+		// Each sample is one light sample and one cosine distributed scattering sample, weighted with MIS.
+		Pcg32 random(11);
+		const int sampleCount = 20000;
+		float lightSum = 0.0f;
+		float scatterSum = 0.0f;
+		for (int i = 0; i < sampleCount; ++i)
+		{
+			LightSample sample;
+			if (lights.sample(vec3(0.0f), random.nextFloat(), vec2(random.nextFloat(), random.nextFloat()), sample))
+			{
+				float scatterPdf = std::max(glm::dot(normal, sample.direction), 0.0f) / Math::Pi;
+				float value = emitted * scatterPdf; // White BRDF times the cosine is the same as the pdf.
+				lightSum += value * powerHeuristic(sample.pdf, scatterPdf) / sample.pdf;
+			}
+
+			vec3 direction = sampleCosineHemisphere(random.nextFloat(), random.nextFloat());
+			if (hitsSphere(vec3(0.0f), direction, center, radius))
+			{
+				float scatterPdf = direction.y / Math::Pi;
+				scatterSum += emitted * powerHeuristic(scatterPdf, lights.pdf(0, vec3(0.0f)));
+			}
+		}
+
+		THEN( "the weighted light and scattering samples add up to the exact reflected light" )
+		{
+			float estimate = (lightSum + scatterSum) / float(sampleCount);
+			REQUIRE( estimate == Approx(expected).epsilon(0.02) );
+			// Sampling the light is the better strategy here, so it gets most of the weight.
+			REQUIRE( lightSum > 4.0f * scatterSum );
+		}
+	}
+}
+
+#endif
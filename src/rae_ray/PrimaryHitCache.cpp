@@ -0,0 +1,34 @@
+#include "rae_ray/PrimaryHitCache.hpp"
+
+#include <algorithm>
+
+using namespace rae;
+
+void PrimaryHitCache::init(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+
+	// With fewer strata the antialiasing would converge to too few fixed points per pixel.
+	m_strata = (width * height * PrimaryHitCacheMaxStrata * PrimaryHitCacheMaxStrata <= PrimaryHitCacheMaxEntries)
+		? PrimaryHitCacheMaxStrata
+		: 0;
+
+	m_hits.clear();
+	if (isAvailable())
+		m_hits.resize(width * height * m_strata * m_strata);
+}
+
+void PrimaryHitCache::clear()
+{
+	std::fill(m_hits.begin(), m_hits.end(), CachedHit());
+}
+
+int PrimaryHitCache::snapJitter(vec2& jitter) const
+{
+	const int stratumX = std::min(int(jitter.x * float(m_strata)), m_strata - 1);
+	const int stratumY = std::min(int(jitter.y * float(m_strata)), m_strata - 1);
+	jitter.x = (float(stratumX) + 0.5f) / float(m_strata);
+	jitter.y = (float(stratumY) + 0.5f) / float(m_strata);
+	return stratumY * m_strata + stratumX;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "rae/core/Types.hpp"
+
+namespace rae
+{
+
+// The strata per pixel on each axis, and the most hits in total. The big buffer doesn't fit, so the cache is only
+// used with the small buffer, and the final render keeps its full antialiasing.
+const int PrimaryHitCacheMaxStrata = 4;
+const int PrimaryHitCacheMaxEntries = 1 << 23;
+
+// The first hit of a camera ray, or a miss. The hit point is the ray at t, and the material is the one of the primitive.
+struct CachedHit
+{
+	float t = -1.0f; // Negative until the ray has been traced.
+	int primitive = -1; // The primitive of the RenderScene which was hit, or -1 for a miss.
+	vec3 normal;
+
+	bool isTraced() const { return t >= 0.0f; }
+};
+
+// The first hits of the camera rays, for each pixel and each jitter stratum inside the pixel. While the camera
+// stays still and has no depth of field, the camera rays of a stratum are always the same, so the hits can be
+// reused and the passes start straight from the first bounce. The jitter is snapped to the centres of the strata,
+// so the antialiasing is limited to the strata, e.g. 16 fixed points per pixel.
+// Usage example:
+// cache.init(width, height);
+// int stratum = cache.snapJitter(jitter); // For each sample, before making the camera ray from the jitter.
+// CachedHit& hit = cache.modifyHit(x, y, stratum);
+class PrimaryHitCache
+{
+public:
+	// Leaves the cache unavailable if the size doesn't fit in PrimaryHitCacheMaxEntries.
+	void init(int width, int height);
+	void clear();
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	// The strata per pixel on each axis, or 0 if the cache is unavailable.
+	int strata() const { return m_strata; }
+	bool isAvailable() const { return m_strata > 1; }
+
+	// Moves the jitter, from 0 to 1 inside the pixel, to the centre of its stratum. Returns the index of the stratum.
+	int snapJitter(vec2& jitter) const;
+	CachedHit& modifyHit(int x, int y, int stratum)
+	{
+		return m_hits[(y * m_width + x) * m_strata * m_strata + stratum];
+	}
+
+protected:
+	int m_width = 0;
+	int m_height = 0;
+	int m_strata = 0;
+	Array<CachedHit> m_hits;
+};
+
+} // namespace rae
@@ -0,0 +1,64 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/PrimaryHitCache.hpp"
+
+using namespace rae;
+
+SCENARIO("PrimaryHitCache unittest", "[rae][PrimaryHitCache]")
+{
+	GIVEN( "a cache for the small buffer" )
+	{
+		PrimaryHitCache cache;
+		cache.init(300, 150);
+
+		THEN( "it has the most strata" )
+		{
+			REQUIRE( cache.isAvailable() );
+			REQUIRE( cache.strata() == PrimaryHitCacheMaxStrata );
+		}
+
+		THEN( "the jitter is snapped to the centre of its stratum" )
+		{
+			vec2 jitter(0.1f, 0.99f);
+			int stratum = cache.snapJitter(jitter);
+			REQUIRE( stratum == 3 * 4 + 0 );
+			REQUIRE( jitter.x == Approx(0.125f) );
+			REQUIRE( jitter.y == Approx(0.875f) );
+
+			vec2 sameStratum(0.2f, 0.8f);
+			REQUIRE( cache.snapJitter(sameStratum) == stratum );
+			REQUIRE( sameStratum == jitter );
+		}
+
+		THEN( "the hits are kept until cleared" )
+		{
+			CachedHit& hit = cache.modifyHit(299, 149, 15);
+			REQUIRE_FALSE( hit.isTraced() );
+
+			hit.t = 2.0f;
+			hit.primitive = 5;
+			REQUIRE( cache.modifyHit(299, 149, 15).isTraced() );
+			REQUIRE_FALSE( cache.modifyHit(299, 149, 14).isTraced() );
+
+			cache.clear();
+			REQUIRE_FALSE( cache.modifyHit(299, 149, 15).isTraced() );
+		}
+	}
+
+	GIVEN( "a cache for the big buffer" )
+	{
+		PrimaryHitCache cache;
+		cache.init(1920, 1080);
+
+		THEN( "it is unavailable, as the most strata don't fit in the memory" )
+		{
+			REQUIRE_FALSE( cache.isAvailable() );
+			REQUIRE( cache.strata() == 0 );
+		}
+	}
+}
+
+#endif
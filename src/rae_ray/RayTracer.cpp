@@ -1,6 +1,7 @@
 #include "RayTracer.hpp"
 
 #include <thread>
+#include <algorithm>
 
 #include "rae/core/Utils.hpp"
 #include "rae/core/Random.hpp"
@@ -78,9 +79,23 @@ RayTracer::RayTracer(
 		m_assetSystem(assetSystem),
 		m_sceneSystem(sceneSystem)
 {
-	m_frameReady = false;
 	m_requestClear = false;
 	m_requestToggleBuffer = false;
+	m_requestSceneUpdate = false;
+	m_requestPresent = false;
+	m_requestReproject = false;
+	m_requestResample = false;
+	m_isVisualizeConvergence = false;
+	m_isDenoise = true;
+	m_isLightSampling = true;
+	m_isPrimaryHitCache = false;
+	m_currentSample = 0;
+	m_renderThreadActive = false;
+	m_tileOrder = TileOrder::Spiral;
+	m_samplerType = SamplerType::Sobol;
+	m_adaptiveThreshold = 0.02f;
+	m_convergedTilePercentage = 0;
+	m_isConverged = false;
 
 	setIsEnabled(false);
 
@@ -102,6 +117,7 @@ RayTracer::RayTracer(
 RayTracer::~RayTracer()
 {
 	m_renderThreadActive = false;
+	wakeRenderThread();
 	if (m_renderThread.joinable())
 	{
 		m_renderThread.join();
@@ -110,41 +126,81 @@ RayTracer::~RayTracer()
 
 void RayTracer::updateScene(const Scene& scene)
 {
-	/* RAE_TODO possibly remove this, because we don't want BVH to be done like this:
-	const Camera& camera = scene.cameraSystem().currentCamera();
-	const auto& transformSystem = scene.transformSystem();
-	const auto& selectionSystem = scene.selectionSystem();
-	const auto& assetLinkSystem = scene.assetLinkSystem();
+	m_compiledScene.compile(scene, m_assetSystem);
+	m_compiledTransformCount = scene.transformSystem().transformCount();
+	handOverScene(true);
+}
+
+void RayTracer::updateScene(const Scene& scene, const Array<Id>& changedIds, const Array<Id>& destroyedIds)
+{
+	// Removing moves the primitives around, so the render thread has to see it like a compile.
+	const bool isRemoved = m_compiledScene.remove(destroyedIds);
 
-	query<MeshLink>(assetLinkSystem.meshLinks(), [&](Id id, const MeshLink& meshLink)
+	// Entities were created, or a new one needs tracing.
+	if (m_compiledTransformCount != scene.transformSystem().transformCount() ||
+		!m_compiledScene.patch(scene, m_assetSystem, changedIds))
 	{
-		Material* material = nullptr;
-		const Mesh& mesh = m_assetSystem.getMesh(assetLinkSystem.meshLinks().get(id));
+		updateScene(scene);
+		return;
+	}
+	handOverScene(isRemoved);
+}
 
-		if (m_assetSystem.isMaterial(id))
-			material = &m_assetSystem.getMaterial(id);
-		else if (assetLinkSystem.materialLinks().check(id))
-			material = &m_assetSystem.getMaterial(assetLinkSystem.materialLinks().get(id));
+void RayTracer::destroyEntities(const Array<Id>& entities)
+{
+	ISystem::destroyEntities(entities);
+	m_destroyedIds.insert(m_destroyedIds.end(), entities.begin(), entities.end());
+}
 
-		if (transformSystem.hasTransform(id) &&
-			material)
-		{
-			const Transform& transform = transformSystem.getTransform(id);
+void RayTracer::handOverScene(bool isCompiled)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_handOverMutex);
+		m_handOverScene = m_compiledScene;
+		// Stays set until taken, in case the render thread skips a patched scene which came after it.
+		m_isHandOverCompiled = m_isHandOverCompiled || isCompiled;
+	}
+	m_isSceneCompiled = true;
+	requestSceneUpdate();
+}
 
-			//#ifdef RAE_DEBUG
-				LOG_F(INFO, "Adding Mesh to raytracer. id: %i", id);
-				//LOG_F(INFO, "MeshLink is: %i", assetLinkSystem.m_meshLinks.get(id));
-			//#endif
+void RayTracer::takeScene()
+{
+	bool isCompiled;
+	{
+		std::lock_guard<std::mutex> lock(m_handOverMutex);
+		std::swap(m_renderScene, m_handOverScene);
+		isCompiled = m_isHandOverCompiled;
+		m_isHandOverCompiled = false;
+	}
 
-			m_world.add(
-				new OldSphere(transform.position, 0.5f,
-				new Lambertian(material->color3()))
-				);
+	m_lights.clear();
+	for (int i = 0; i < m_renderScene.primitiveCount(); ++i)
+	{
+		const RenderPrimitive& primitive = m_renderScene.primitive(i);
+		const Material& material = m_renderScene.material(primitive.materialIndex);
+		if (primitive.type == PrimitiveType::Sphere && material.materialType() == MaterialType::Light)
+		{
+			m_lights.addSphere(primitive.id, primitive.sphereCenter(), primitive.sphere.radius,
+				material.emitted(primitive.sphereCenter()));
 		}
-	});
+	}
+	m_lights.finalize();
 
-	m_tree.init(m_world.list(), 0, 0);
-	*/
+	// A patch keeps the primitive indices, and the visible changes clear the cache through clear(), but after
+	// a compile the cached hits point to the primitives of the old scene.
+	if (isCompiled)
+		m_primaryHits.clear();
+
+	// A scene which wasn't cleared can still change the shadows and reflections of the image, so the converged
+	// tiles are sampled again.
+	m_isConverged = false;
+}
+
+Camera RayTracer::handOverCamera()
+{
+	std::lock_guard<std::mutex> lock(m_handOverMutex);
+	return m_handOverCamera;
 }
 
 /*
@@ -283,6 +339,7 @@ void RayTracer::checkShouldStartRenderThread()
 	else if (!m_isEnabled && m_renderThread.joinable())
 	{
 		m_renderThreadActive = false;
+		wakeRenderThread();
 		m_renderThread.join();
 	}
 }
@@ -312,19 +369,62 @@ void RayTracer::clearScene()
 {
 	m_world.clear();
 	m_sceneSystem.modifyActiveScene().modifyCameraSystem().setNeedsUpdate();
-	clear();
+	// The buffers belong to the render thread, so it does the clearing.
+	requestClear();
 }
 
 void RayTracer::requestClear()
 {
 	m_requestClear = true;
+	wakeRenderThread();
+}
+
+void RayTracer::requestPresent()
+{
+	m_requestPresent = true;
+	wakeRenderThread();
+}
+
+void RayTracer::requestReproject()
+{
+	m_requestReproject = true;
+	wakeRenderThread();
+}
+
+void RayTracer::requestResample()
+{
+	m_requestResample = true;
+	wakeRenderThread();
+}
+
+void RayTracer::wakeRenderThread()
+{
+	{
+		// Taking the lock makes sure that the render thread is either already waiting, or will see the request
+		// when it checks hasRenderWork before waiting. Otherwise the notification could be lost in between.
+		std::lock_guard<std::mutex> lock(m_renderWakeMutex);
+	}
+	m_renderWakeUp.notify_one();
 }
 
 void RayTracer::clear()
 {
-	std::lock_guard<std::mutex> lock(m_bufferMutex);
-	m_frameReady = false;
 	m_buffer->clear();
+	if (m_convergence.width() != m_buffer->width() || m_convergence.height() != m_buffer->height())
+		m_convergence.init(m_buffer->width(), m_buffer->height());
+	else m_convergence.clear();
+	if (m_denoiser.width() != m_buffer->width() || m_denoiser.height() != m_buffer->height())
+		m_denoiser.init(m_buffer->width(), m_buffer->height());
+	else m_denoiser.clear();
+	if (m_reprojection.width() != m_buffer->width() || m_reprojection.height() != m_buffer->height())
+		m_reprojection.init(m_buffer->width(), m_buffer->height());
+	else m_reprojection.clear();
+	if (m_primaryHits.width() != m_buffer->width() || m_primaryHits.height() != m_buffer->height())
+		m_primaryHits.init(m_buffer->width(), m_buffer->height());
+	else m_primaryHits.clear();
+	m_hasRenderCamera = false;
+	m_convergedTilePercentage = 0;
+	m_isConverged = false;
 	m_currentSample = 0;
 	m_totalRayTracingTime = -1.0;
 	m_startTime = -1.0f;
@@ -338,6 +438,38 @@ std::string toString(const HitRecord& record)
 		+ std::to_string(record.point.z) + ")";
 }
 
+namespace rae
+{
+
+bool isAutoFocusNeeded(const FrameChanges& changes, bool isFocusOnSelection)
+{
+	return changes.isTransformChanged
+		|| changes.isCameraChanged
+		|| (isFocusOnSelection && changes.isSelectionChanged);
+}
+
+AccumulationAction accumulationAction(const FrameChanges& changes)
+{
+	// The changes outside of the view fade in with the new samples, but after the samples limit there are none.
+	if (changes.isVisibleChange || changes.isFirstCamera || (changes.isSceneChanged && changes.isSamplesLimitReached))
+		return AccumulationAction::Clear;
+
+	if (!changes.isCameraChanged)
+		return AccumulationAction::Keep;
+
+	if (changes.isViewChanged)
+	{
+		// When only the camera moved, the surfaces are where they were and their samples can be kept.
+		return changes.isReprojection ? AccumulationAction::Reproject : AccumulationAction::Clear;
+	}
+
+	// The focus or the aperture changed. The surfaces stay where they are but the blur changes,
+	// which reprojecting can't fix. Without an aperture there's no blur to change.
+	return changes.aperture > 0.0f ? AccumulationAction::Clear : AccumulationAction::Keep;
+}
+
+} // end namespace rae
+
 void RayTracer::autoFocus()
 {
 	auto& scene = m_sceneSystem.modifyActiveScene();
@@ -345,7 +477,7 @@ void RayTracer::autoFocus()
 	auto& assetLinkSystem = scene.assetLinkSystem();
 	Camera& camera = scene.modifyCameraSystem().modifyCurrentCamera();
 
-	if (scene.selectionSystem().isSelection())
+	if (m_isFocusOnSelection && scene.selectionSystem().isSelection())
 	{
 		auto selectedIds = scene.selectionSystem().selectedIds();
 		const Transform& transform = transformSystem.getWorldTransform(selectedIds.front());
@@ -407,7 +539,8 @@ void RayTracer::autoFocus()
 				||
 				(!transformSystem.hasSphere(id) &&
 				assetLinkSystem.hasMeshLink(id) &&
-				m_assetSystem.getMesh(assetLinkSystem.getMeshLink(id)).hit(transform, ray, 0.001f, closestSoFar, record)))
+				m_assetSystem.getMesh(assetLinkSystem.getMeshLink(id)).hit(
+					transformSystem.getInverseWorldMatrix(id), ray, 0.001f, closestSoFar, record)))
 			{
 				closestSoFar = record.t;
 				finalRecord = record;
@@ -433,117 +566,77 @@ void RayTracer::autoFocus()
 	}
 }
 
-vec3 RayTracer::rayTrace(const Ray& ray, int depth)
+bool RayTracer::hitScene(const Ray& ray, float maxDistance, int& outPrimitive, HitRecord& outRecord)
+{
+	return m_renderScene.hit(ray, 0.001f, maxDistance, outPrimitive, outRecord);
+}
+
+vec3 RayTracer::rayTrace(const Ray& primaryRay, Sampler& sampler, FirstHit* outFirstHit, CachedHit* cachedHit)
 {
-	/* RAE_TODO possibly remove:
-	if (m_tree.hit(ray, 0.001f, rayMaxLength(), record))
+	const Camera& camera = m_renderCamera;
+
+	// The light gathered along the path, and how much of the light arriving at the current ray
+	// still makes it back to the camera after all the bounces so far.
+	vec3 radiance = vec3(0.0f, 0.0f, 0.0f);
+	vec3 throughput = vec3(1.0f, 1.0f, 1.0f);
+	Ray ray = primaryRay;
+
+	const bool isLightSampling = m_isLightSampling && !m_lights.isEmpty();
+	// Where the last diffuse bounce was, and the pdf of its scattered direction. When the scattered ray hits
+	// a light, that light was also sampled directly from there, so the two are weighted against each other.
+	bool isLastBounceDiffuse = false;
+	float lastScatterPdf = 0.0f;
+	vec3 lastPoint;
+
+	for (int bounce = 0; bounce <= m_bouncesLimit; ++bounce)
 	{
-		// Visualize focus distance with a line
-		if (m_isVisualizeFocusDistance)
+		int primitiveIndex = -1;
+		HitRecord record;
+		bool isHit = false;
+		if (bounce == 0 && cachedHit && cachedHit->isTraced())
 		{
-			float hitDistance = glm::length(record.point - camera.position());
-			if (Utils::isEqual(camera.focusDistance(), hitDistance, 0.01f) == true)
-			{
-				return vec3(0,1,1); // cyan line
-			}
+			isHit = (cachedHit->primitive >= 0);
+			primitiveIndex = cachedHit->primitive;
+			record.t = cachedHit->t;
+			record.point = ray.getPointAt(cachedHit->t);
+			record.normal = cachedHit->normal;
 		}
-
-		// Normal raytracing
-		if (isFastMode() == false)
+		else
 		{
-			Ray scattered;
-			vec3 attenuation;
-			vec3 emitted = record.material->emitted(record.point);
-
-			if (depth < m_bouncesLimit && record.material->scatter(ray, record, attenuation, scattered))
-			{
-				return emitted + attenuation * rayTrace(scattered, depth + 1);
-			}
-			else
+			isHit = hitScene(ray, rayMaxLength(), primitiveIndex, record);
+			if (bounce == 0 && cachedHit)
 			{
-				return emitted;
+				cachedHit->t = isHit ? record.t : 0.0f;
+				cachedHit->primitive = isHit ? primitiveIndex : -1;
+				cachedHit->normal = record.normal;
 			}
 		}
-		else // FastMode returns just the material color
-		{
-			return record.material->color3();
-		}
-	}
-	*/
-
-	//scene.transformSystem().processHierarchy();
 
-	const auto& scene = m_sceneSystem.activeScene();
-
-	const Camera& camera = scene.cameraSystem().currentCamera();
-	HitRecord finalRecord;
-
-	const auto& transformSystem = scene.transformSystem();
-	const auto& assetLinkSystem = scene.assetLinkSystem();
-
-	auto sphereHitFunc = [](
-		const vec3& position,
-		float radius,
-		const Ray& ray,
-		float t_min,
-		float t_max,
-		HitRecord& record) -> bool
-	{
-		vec3 oc = ray.origin() - position;
-		float a = glm::dot(ray.direction(), ray.direction());
-		float b = glm::dot(oc, ray.direction());
-		float c = glm::dot(oc, oc) - radius * radius;
-		float discriminant = b * b - a * c;
-		if (discriminant > 0)
+		if (!isHit)
 		{
-			float temp = (-b - sqrt(discriminant)) / a;
-			if (temp < t_max && temp > t_min)
+			if (bounce == 0 && outFirstHit)
 			{
-				record.t = temp;
-				record.point = ray.getPointAt(record.t);
-				record.normal = (record.point - position) / radius;
-				return true;
+				outFirstHit->isHit = false;
+				outFirstHit->features.albedo = sky(ray);
+				outFirstHit->features.normal = vec3(0.0f, 0.0f, 0.0f);
 			}
-		}
-		return false;
-	};
-
-	vec3 resultColor = vec3(0,0,0);
-	bool hit = false;
-	bool needsScatter = false;
-	bool hitLine = false;
-	Ray scattered;
-
-	float closestSoFar = rayMaxLength();
-
-	query<Box>(transformSystem.boxes(), [&](Id id, const Box& box)
-	{
-		HitRecord record;
-
-		const Transform& transform = transformSystem.getWorldTransform(id);
 
-		//LOG_F(INFO, "raytrace box: %i", (int)id);
+			radiance += throughput * sky(ray);
+			break;
+		}
 
-		Material& defaultMaterial = m_assetSystem.modifyMaterial(assetLinkSystem.getMaterialLink(id));
+		const RenderPrimitive& primitive = m_renderScene.primitive(primitiveIndex);
+		record.material = &m_renderScene.material(primitive.materialIndex);
 
-		// This is pretty random. So we check if it's a Sphere or a Mesh... and do hit testing on those... yeah. Need to refactor.
-		if ((transformSystem.hasSphere(id)
-			&& sphereHitFunc(transform.position, box.radius() * transform.scale.x, ray, 0.001f, closestSoFar, record))
-			||
-			(!transformSystem.hasSphere(id) &&
-			assetLinkSystem.hasMeshLink(id) &&
-			m_assetSystem.getMesh(assetLinkSystem.getMeshLink(id)).hit(transform, ray, 0.001f, closestSoFar, record)))
+		if (bounce == 0)
 		{
-			bool hitLineLocal = false;
-
-			record.material = &defaultMaterial;
-
-			closestSoFar = record.t;
-			finalRecord = record;
-
-			hit = true;
-
-			//LOG_F(INFO, "raytrace box: %i HIT", (int)id);
+			if (outFirstHit)
+			{
+				outFirstHit->isHit = true;
+				outFirstHit->position = record.point;
+				outFirstHit->features.albedo = record.material->color3();
+				outFirstHit->features.normal = glm::normalize(record.normal);
+			}
 
 			// Visualize focus distance with a line
 			if (m_isVisualizeFocusDistance)
@@ -551,61 +644,94 @@ vec3 RayTracer::rayTrace(const Ray& ray, int depth)
 				float hitDistance = glm::length(record.point - camera.position());
 				if (Math::isEqual(camera.focusDistance(), hitDistance, 0.01f) == true)
 				{
-					hitLine = true;
-					hitLineLocal = true;
-					resultColor = vec3(0,1,1); // cyan line
+					return vec3(0,1,1); // cyan line
 				}
 			}
 
-			if (!hitLineLocal)
+			// FastMode returns just the material color
+			if (isFastMode())
 			{
-				// Normal raytracing
-				if (isFastMode() == false)
-				{
-					vec3 attenuation;
-					vec3 emitted = record.material->emitted(record.point);
-
-					hitLine = false;
+				return record.material->color3();
+			}
+		}
 
-					if (depth < m_bouncesLimit && record.material->scatter(ray, record, attenuation, scattered))
-					{
-						needsScatter = true;
-						resultColor = emitted + attenuation;
-					}
-					else
-					{
-						resultColor = emitted;
-					}
-				}
-				else // FastMode returns just the material color
-				{
-					resultColor = record.material->color3();
-				}
+		vec3 emitted = record.material->emitted(record.point);
+		if (emitted != vec3(0.0f, 0.0f, 0.0f))
+		{
+			float misWeight = 1.0f;
+			if (isLightSampling && isLastBounceDiffuse)
+			{
+				int lightIndex = m_lights.findLight(primitive.id);
+				if (lightIndex >= 0)
+					misWeight = powerHeuristic(lastScatterPdf, m_lights.pdf(lightIndex, lastPoint));
 			}
+			radiance += throughput * emitted * misWeight;
 		}
 
+		if (bounce == m_bouncesLimit)
+			break;
 
-		//mat4 translationMatrix = glm::translate(mat4(1.0f), transform.position);
-		//mat4 rotationMatrix = glm::toMat4(transform.rotation);
-		//mat4 scaleMatrix = glm::scale(mat4(1.0f), transform.scale);
-		//mat4 modelMatrix = translationMatrix * rotationMatrix * scaleMatrix;
+		// Next event estimation. The light reaching this point through a single bounce is counted here,
+		// and also by the next bounce if the scattered ray hits the light, with the weights adding up to one.
+		if (isLightSampling && record.material->isDiffuse())
+		{
+			radiance += throughput * sampleDirectLight(record, sampler, bounce);
+		}
 
-		// The model-view-projection matrix
-		//glm::mat4 combinedMatrix = camera.getProjectionAndViewMatrix() * modelMatrix;
-	});
+		vec3 attenuation;
+		Ray scattered;
+		if (!record.material->scatter(ray, record, sampler.get3D(bounceDimension(bounce, ScatterDimension)), attenuation, scattered))
+			break;
 
-	if (hit)
-	{
-		if (needsScatter && !hitLine)
+		throughput *= attenuation;
+
+		isLastBounceDiffuse = record.material->isDiffuse();
+		if (isLastBounceDiffuse)
 		{
-			// RAE_TODO get rid of this recursion:
-			resultColor *= rayTrace(scattered, depth + 1);
+			lastScatterPdf = record.material->scatterPdf(record, glm::normalize(scattered.direction()));
+			lastPoint = record.point;
 		}
 
-		return resultColor;
+		// Russian roulette: after a few bounces, end the paths randomly with a probability which grows
+		// as the throughput gets darker. The surviving paths are weighted up, so the result stays unbiased,
+		// but the time isn't wasted on deep paths which hardly contribute anything.
+		if (bounce >= RussianRouletteMinBounces)
+		{
+			float survival = std::min(std::max(throughput.x, std::max(throughput.y, throughput.z)), 0.95f);
+			if (sampler.get1D(bounceDimension(bounce, RouletteDimension)) >= survival)
+				break;
+			throughput /= survival;
+		}
+
+		ray = scattered;
 	}
 
-	return sky(ray);
+	return radiance;
+}
+
+vec3 RayTracer::sampleDirectLight(const HitRecord& record, Sampler& sampler, int bounce)
+{
+	LightSample lightSample;
+	if (!m_lights.sample(
+			record.point,
+			sampler.get1D(bounceDimension(bounce, LightChoiceDimension)),
+			sampler.get2D(bounceDimension(bounce, LightDirectionDimension)),
+			lightSample))
+		return vec3(0.0f, 0.0f, 0.0f);
+
+	vec3 value = record.material->evaluate(record, lightSample.direction);
+	if (value == vec3(0.0f, 0.0f, 0.0f))
+		return value;
+
+	// The shadow ray. The light is visible if it's the closest thing in that direction.
+	int hitPrimitive = -1;
+	HitRecord shadowRecord;
+	if (!hitScene(Ray(record.point, lightSample.direction), FLT_MAX, hitPrimitive, shadowRecord) ||
+		m_renderScene.primitive(hitPrimitive).id != m_lights.lightId(lightSample.lightIndex))
+		return vec3(0.0f, 0.0f, 0.0f);
+
+	float misWeight = powerHeuristic(lightSample.pdf, record.material->scatterPdf(record, lightSample.direction));
+	return value * lightSample.emitted * (misWeight / lightSample.pdf);
 }
 
 vec3 RayTracer::sky(const Ray& ray)
@@ -620,20 +746,81 @@ vec3 RayTracer::sky(const Ray& ray)
 
 UpdateStatus RayTracer::update()
 {
-	if (m_sceneSystem.activeScene().transformSystem().hasAnyTransformChanged() ||
-		m_sceneSystem.activeScene().cameraSystem().hasCameraUpdated() ||
-		m_sceneSystem.activeScene().selectionSystem().hasSelectionChanged())
+	const Scene& scene = m_sceneSystem.activeScene();
+	FrameChanges changes;
+	changes.isTransformChanged = scene.transformSystem().hasAnyTransformChanged();
+	changes.isSelectionChanged = scene.selectionSystem().hasSelectionChanged();
+	changes.isCameraChanged = scene.cameraSystem().hasCameraUpdated();
+
+	if (isAutoFocusNeeded(changes, m_isFocusOnSelection))
 	{
 		autoFocus();
-		requestClear();
 	}
 
 	if (!m_isEnabled)
+	{
+		// Nothing traces the snapshot meanwhile, so it's compiled and handed over again when enabled.
+		m_isSceneCompiled = false;
+		m_isCameraHandedOver = false;
+		m_destroyedIds.clear();
 		return UpdateStatus::Disabled;
+	}
+
+	// The matrices are only rebuilt for the changed world transforms, and their updated flags last until the end
+	// of the frame, unlike the flags of the transforms which the sync clears.
+	Array<Id> changedIds;
+	if (changes.isTransformChanged)
+	{
+		queryUpdated(scene.transformSystem().worldMatrices(), [&](Id id, const mat4&)
+		{
+			changedIds.emplace_back(id);
+		});
+	}
+
+	// Creating entities doesn't change any transforms, so it only shows in the count.
+	const bool isCountChanged = m_compiledTransformCount != scene.transformSystem().transformCount();
+	const bool isAnyDestroyed = !m_destroyedIds.empty();
+
+	// The render thread only sees the scene and the camera through the hand over, so it never reads
+	// the tables while they're being modified. The selection and hovering don't show in the traced image,
+	// and the transforms only matter when the things were or are in the view.
+	if (!m_isSceneCompiled || m_assetSystem.hasAnyMaterialChanged())
+	{
+		updateScene(scene);
+		resetTracedBounds();
+		changes.isVisibleChange = true;
+	}
+	else if (changes.isTransformChanged || isCountChanged || isAnyDestroyed)
+	{
+		updateScene(scene, changedIds, m_destroyedIds);
+		changes.isVisibleChange = updateChangedBounds(scene, changedIds, m_destroyedIds, isCountChanged);
+		changes.isSceneChanged = true;
+	}
+	m_destroyedIds.clear();
+
+	const Camera& camera = scene.cameraSystem().currentCamera();
+	changes.isFirstCamera = !m_isCameraHandedOver;
+	// Only the main thread writes the handed over camera, so it can be read here without the lock.
+	changes.isViewChanged = changes.isFirstCamera || !camera.hasSameView(m_handOverCamera);
+	changes.aperture = std::max(camera.aperture(), m_handOverCamera.aperture());
+	changes.isSamplesLimitReached = isSamplesLimitReached();
+	changes.isReprojection = m_isReprojection;
+	{
+		std::lock_guard<std::mutex> lock(m_handOverMutex);
+		m_handOverCamera = camera;
+	}
+	m_isCameraHandedOver = true;
 
-	// RAE_TODO visualize BVH boxes again (but currently we are not using BVH anyway):
+	switch (accumulationAction(changes))
+	{
+		case AccumulationAction::Keep: break;
+		case AccumulationAction::Reproject: requestReproject(); break;
+		case AccumulationAction::Clear: requestClear(); break;
+	}
+
+	// RAE_TODO visualize BVH boxes again (the nodes of m_compiledScene could be drawn here, with an accessor):
 	/*
-	m_tree.iterate([](const Box& box)
+	m_compiledScene.iterate([](const Box& box)
 	{
 		g_debugSystem->drawLineBox(box, Colors::blue);
 	});
@@ -665,20 +852,14 @@ UpdateStatus RayTracer::update()
 
 	#ifdef RENDER_ALL_AT_ONCE
 		renderAllAtOnce();
-		if (m_currentSample <= m_allAtOnceSamplesLimit) // do once more than render
-		{
-			updateImageBuffer();
-		}
-	#else
-
-		if (m_frameReady == true)
-		{
-			updateImageBuffer();
-			m_frameReady = false;
-		}
-
 	#endif
 
+	// Only if the render thread has presented a new frame since the last update. Never waits for it.
+	if (m_frames.swapFront())
+	{
+		updateImageBuffer();
+	}
+
 	m_totalRayTracingTime = m_time.time() - m_startTime;
 
 	return UpdateStatus::Changed;
@@ -688,30 +869,148 @@ void RayTracer::updateRenderThread()
 {
 	while (m_renderThreadActive)
 	{
-		if (!m_buffer)
+		if (m_requestToggleBuffer.exchange(false))
 		{
-			continue;
+			toggleBufferQuality();
+			m_requestClear = true;
 		}
 
-		if (m_frameReady == false)
+		if (m_requestClear.exchange(false))
 		{
-			if (m_requestToggleBuffer)
-			{
-				toggleBufferQuality();
-				m_requestToggleBuffer = false;
-				m_requestClear = true;
-			}
+			clear();
+		}
+
+		if (m_requestSceneUpdate.exchange(false))
+		{
+			takeScene();
+		}
+
+		if (m_requestReproject.exchange(false))
+		{
+			reprojectSamples();
+		}
+
+		// After the pass which was still rendering with the old settings, as it would overwrite m_isConverged.
+		if (m_requestResample.exchange(false))
+		{
+			m_isConverged = false;
+		}
+
+		if (!isRenderingDone())
+		{
+			m_requestPresent = false;
+			renderSamples();
+			presentFrame();
+		}
+		else if (m_requestPresent.exchange(false))
+		{
+			presentFrame();
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock(m_renderWakeMutex);
+			m_renderWakeUp.wait(lock, [this]() { return hasRenderWork(); });
+		}
+	}
+}
 
-			if (m_requestClear)
+TracedBounds RayTracer::getTracedBounds(int primitiveIndex) const
+{
+	const RenderPrimitive& primitive = m_compiledScene.primitive(primitiveIndex);
+	TracedBounds traced;
+	traced.box = m_compiledScene.bounds(primitiveIndex);
+	traced.isLight = m_compiledScene.material(primitive.materialIndex).materialType() == MaterialType::Light;
+	return traced;
+}
+
+void RayTracer::resetTracedBounds()
+{
+	m_tracedBounds.clear();
+	for (int i = 0; i < m_compiledScene.primitiveCount(); ++i)
+	{
+		m_tracedBounds[m_compiledScene.primitive(i).id] = getTracedBounds(i);
+	}
+}
+
+bool RayTracer::updateChangedBounds(
+	const Scene& scene,
+	const Array<Id>& changedIds,
+	const Array<Id>& destroyedIds,
+	bool isCountChanged)
+{
+	const Camera& camera = scene.cameraSystem().currentCamera();
+
+	// A light lights up things outside of its bounds too, so its changes always show.
+	auto isVisible = [&](const TracedBounds& traced)
+	{
+		return traced.isLight || camera.isInView(traced.box);
+	};
+
+	bool isAnyVisible = false;
+	for (Id id : changedIds)
+	{
+		const int index = m_compiledScene.findPrimitive(id);
+		if (index == -1)
+			continue;
+
+		TracedBounds traced = getTracedBounds(index);
+		auto found = m_tracedBounds.find(id);
+		if (isVisible(traced) || (found != m_tracedBounds.end() && isVisible(found->second)))
+			isAnyVisible = true;
+
+		m_tracedBounds[id] = traced;
+	}
+
+	for (Id id : destroyedIds)
+	{
+		auto found = m_tracedBounds.find(id);
+		if (found == m_tracedBounds.end())
+			continue;
+
+		if (isVisible(found->second))
+			isAnyVisible = true;
+		m_tracedBounds.erase(found);
+	}
+
+	// The entities which aren't traced anymore are only found by their absence.
+	if (isCountChanged)
+	{
+		for (auto iter = m_tracedBounds.begin(); iter != m_tracedBounds.end();)
+		{
+			if (m_compiledScene.findPrimitive(iter->first) != -1)
 			{
-				clear();
-				m_requestClear = false;
+				++iter;
+				continue;
 			}
 
-			std::lock_guard<std::mutex> lock(m_bufferMutex);
-			renderSamples();
+			if (isVisible(iter->second))
+				isAnyVisible = true;
+			iter = m_tracedBounds.erase(iter);
 		}
 	}
+	return isAnyVisible;
+}
+
+bool RayTracer::isSamplesLimitReached() const
+{
+	return m_samplesLimit > 0 && m_currentSample >= m_samplesLimit;
+}
+
+bool RayTracer::isRenderingDone() const
+{
+	return isSamplesLimitReached() || m_isConverged;
+}
+
+bool RayTracer::hasRenderWork() const
+{
+	return !m_renderThreadActive
+		|| m_requestClear
+		|| m_requestToggleBuffer
+		|| m_requestSceneUpdate
+		|| m_requestPresent
+		|| m_requestReproject
+		|| m_requestResample
+		|| !isRenderingDone();
 }
 
 void RayTracer::updateDebugTexts()
@@ -740,8 +1039,24 @@ void RayTracer::updateDebugTexts()
 	g_debugSystem->showDebugText("Field of View: " + std::to_string(Math::toDegrees(camera.fieldOfView())) + "°");
 	g_debugSystem->showDebugText("Focus distance: " + std::to_string(camera.focusDistance()));
 	g_debugSystem->showDebugText(camera.isContinuousAutoFocus() ? "Autofocus ON" : "Autofocus OFF");
+	g_debugSystem->showDebugText(isFocusOnSelection() ? "Focus on selection ON" : "Focus on selection OFF");
 	g_debugSystem->showDebugText("Aperture: " + std::to_string(camera.aperture()));
 	g_debugSystem->showDebugText("Bounces: " + std::to_string(m_bouncesLimit));
+	g_debugSystem->showDebugText("Tile order: " + toString(tileOrder()));
+	g_debugSystem->showDebugText("Sampler: " + toString(samplerType()));
+	g_debugSystem->showDebugText(isDenoise() ? "Denoise ON" : "Denoise OFF");
+	g_debugSystem->showDebugText(isLightSampling() ? "Light sampling ON" : "Light sampling OFF");
+	g_debugSystem->showDebugText(isReprojection() ? "Reprojection ON" : "Reprojection OFF");
+	if (!isPrimaryHitCache())
+		g_debugSystem->showDebugText("Primary hit cache OFF");
+	else if (camera.aperture() > 0.0f)
+		g_debugSystem->showDebugText("Primary hit cache ON (unused with aperture)");
+	else g_debugSystem->showDebugText("Primary hit cache ON");
+	if (m_adaptiveThreshold > 0.0f)
+	{
+		g_debugSystem->showDebugText("Converged tiles: " + std::to_string(m_convergedTilePercentage) + "%"
+			+ (m_isConverged ? " (done)" : ""));
+	}
 
 	g_debugSystem->showDebugText("Debug hit pos: "
 		+ std::to_string(debugHitRecord.point.x) + ", "
@@ -758,32 +1073,22 @@ void RayTracer::updateDebugTexts()
 void RayTracer::requestToggleBufferQuality()
 {
 	m_requestToggleBuffer = true;
+	wakeRenderThread();
 }
 
 void RayTracer::toggleBufferQuality()
 {
+	// The main thread switches m_uintBuffer when the first frame of the new size arrives.
+	if (m_buffer == &m_smallBuffer)
 	{
-		std::lock_guard<std::mutex> lock(m_bufferMutex);
-		if (m_buffer == &m_smallBuffer)
-		{
-			m_buffer = &m_bigBuffer;
-		}
-		else
-		{
-			m_buffer = &m_smallBuffer;
-		}
-
-		if (m_uintBuffer == &m_smallUintBuffer)
-		{
-			m_uintBuffer = &m_bigUintBuffer;
-		}
-		else
-		{
-			m_uintBuffer = &m_smallUintBuffer;
-		}
-
-		requestClear();
+		m_buffer = &m_bigBuffer;
+	}
+	else
+	{
+		m_buffer = &m_smallBuffer;
 	}
+
+	requestClear();
 }
 
 float RayTracer::rayMaxLength()
@@ -807,6 +1112,52 @@ void RayTracer::minusBounces(int delta)
 	m_bouncesLimit = std::min(5000, m_bouncesLimit);
 }
 
+void RayTracer::setAdaptiveThreshold(float threshold)
+{
+	m_adaptiveThreshold = threshold;
+	// A lower threshold can make the converged tiles noisy again.
+	requestResample();
+}
+
+void RayTracer::setSamplerType(SamplerType type)
+{
+	m_samplerType = type;
+	// The samples of different samplers would be fine to average, but a clean start shows the difference.
+	requestClear();
+}
+
+void RayTracer::nextSamplerType()
+{
+	int next = ((int)samplerType() + 1) % (int)SamplerType::Count;
+	setSamplerType((SamplerType)next);
+}
+
+void RayTracer::nextTileOrder()
+{
+	int next = ((int)tileOrder() + 1) % (int)TileOrder::Count;
+	setTileOrder((TileOrder)next);
+}
+
+void RayTracer::renderTiles(const std::function<void(const Tile&)>& renderTile)
+{
+	const TileOrder order = m_tileOrder;
+	if (m_tilesWidth != m_buffer->width() ||
+		m_tilesHeight != m_buffer->height() ||
+		m_tilesOrder != order)
+	{
+		m_tiles = createTiles(m_buffer->width(), m_buffer->height(), DefaultTileSize, order);
+		m_tilesWidth = m_buffer->width();
+		m_tilesHeight = m_buffer->height();
+		m_tilesOrder = order;
+	}
+
+	// The pool hands out the tasks in order, so the tiles are started in the tile order.
+	m_renderPool.run((int)m_tiles.size(), [&](int tileIndex)
+	{
+		renderTile(m_tiles[tileIndex]);
+	});
+}
+
 void RayTracer::renderAllAtOnce()
 {
 	// timings for 100 samples at 500x250:
@@ -819,24 +1170,32 @@ void RayTracer::renderAllAtOnce()
 		const Camera& camera = m_sceneSystem.activeScene().cameraSystem().currentCamera();
 
 		// Parallel was about 3.6 times faster here. From 48 seconds to 13 seconds with a very low resolution and sample count.
-		parallel_for(0, m_buffer->height(), [&](int y)
+		const SamplerType samplerType = m_samplerType;
+		renderTiles([&](const Tile& tile)
 		{
-			for (int x = 0; x < m_buffer->width(); ++x)
+			std::unique_ptr<Sampler> sampler = createSampler(samplerType);
+			for (int y = tile.y; y < tile.y + tile.height; ++y)
 			{
-				vec3 color;
-
-				for (int sample = 0; sample < m_allAtOnceSamplesLimit; sample++)
+				for (int x = tile.x; x < tile.x + tile.width; ++x)
 				{
-					float u = float(x + drand48()) / float(m_buffer->width());
-					float v = float(y + drand48()) / float(m_buffer->height());
+					vec3 color;
 
-					Ray ray = camera.getRay(u, v);
-					color += rayTrace(ray);
-				}
+					for (int sample = 0; sample < m_allAtOnceSamplesLimit; sample++)
+					{
+						sampler->startPixelSample(x, y, sample, m_randomSeed);
+
+						vec2 jitter = sampler->get2D(PixelDimension);
+						float u = float(x + jitter.x) / float(m_buffer->width());
+						float v = float(y + jitter.y) / float(m_buffer->height());
 
-				color /= float(m_allAtOnceSamplesLimit);
+						Ray ray = camera.getRay(u, v, sampler->get2D(LensDimension));
+						color += rayTrace(ray, *sampler);
+					}
 
-				m_buffer->setPixelColor3(x, y, color);
+					color /= float(m_allAtOnceSamplesLimit);
+
+					m_buffer->setPixelColor3(x, y, color);
+				}
 			}
 		});
 
@@ -844,7 +1203,7 @@ void RayTracer::renderAllAtOnce()
 	}
 	else if (m_currentSample == m_allAtOnceSamplesLimit)
 	{
-		updateImageBuffer();
+		presentFrame();
 		m_currentSample++;
 	}
 }
@@ -858,47 +1217,182 @@ void RayTracer::renderSamples()
 
 	if (m_samplesLimit == 0 || m_currentSample < m_samplesLimit)
 	{
-		// Take a copy of the camera so that it doesn't wobble.
-		Camera camera = m_sceneSystem.activeScene().cameraSystem().currentCamera();
+		// Take a copy of the camera so that it doesn't wobble. It only changes on a clear or a reprojection.
+		if (!m_hasRenderCamera)
+		{
+			m_renderCamera = handOverCamera();
+			m_hasRenderCamera = true;
+		}
+		const Camera& camera = m_renderCamera;
+
+		// Without depth of field the camera rays only depend on the jitter, so their first hits can be reused.
+		const bool isPrimaryHitCache = m_isPrimaryHitCache && m_primaryHits.isAvailable() &&
+			camera.aperture() <= 0.0f && !isFastMode() &&
+			m_primaryHits.width() == m_buffer->width() && m_primaryHits.height() == m_buffer->height();
+
+		const SamplerType samplerType = m_samplerType;
+		const float threshold = m_adaptiveThreshold;
+		// The converged tiles are still sampled now and then, in case the variance was underestimated.
+		const bool isRevisitPass = (m_currentSample % ConvergedTileRevisitPasses) == 0;
+		std::atomic<int> convergedTileCount(0);
 
-		// Single threaded
-		//for (int j = 0; j < m_buffer->height; ++j)
-		// Parallel, about twice the performance
-		parallel_for(0, m_buffer->height(), [&](int y)
+		renderTiles([&](const Tile& tile)
 		{
-			for (int x = 0; x < m_buffer->width(); ++x)
+			if (threshold > 0.0f && m_convergence.isConverged(tile, threshold))
 			{
-				float u = float(x + drand48()) / float(m_buffer->width());
-				float v = float(y + drand48()) / float(m_buffer->height());
+				convergedTileCount++;
+				if (!isRevisitPass)
+					return;
+			}
 
-				Ray ray = camera.getRay(u, v);
-				vec3 color = rayTrace(ray);
+			std::unique_ptr<Sampler> sampler = createSampler(samplerType);
+			for (int y = tile.y; y < tile.y + tile.height; ++y)
+			{
+				for (int x = tile.x; x < tile.x + tile.width; ++x)
+				{
+					// The pixels have different sample counts with adaptive sampling, so the sample index is per pixel.
+					const int sampleIndex = m_convergence.sampleCount(x, y);
 
-				//http://stackoverflow.com/questions/22999487/update-the-average-of-a-continuous-sequence-of-numbers-in-constant-time
-				// add to average
-				m_buffer->setPixelColor3(x, y,
-					(float(m_currentSample) * m_buffer->getPixelColor3(x, y) + color) / float(m_currentSample + 1));
+					// The numbers of every pixel sample only depend on the pixel, the sample and the seed,
+					// no matter which thread renders it, so the same seed gives the same image.
+					sampler->startPixelSample(x, y, sampleIndex, m_randomSeed);
+
+					vec2 jitter = sampler->get2D(PixelDimension);
+					CachedHit* cachedHit = nullptr;
+					if (isPrimaryHitCache)
+					{
+						int stratum = m_primaryHits.snapJitter(jitter);
+						cachedHit = &m_primaryHits.modifyHit(x, y, stratum);
+					}
+
+					float u = float(x + jitter.x) / float(m_buffer->width());
+					float v = float(y + jitter.y) / float(m_buffer->height());
+
+					Ray ray = isPrimaryHitCache
+						? camera.getExactRay(u, v)
+						: camera.getRay(u, v, sampler->get2D(LensDimension));
+					FirstHit firstHit;
+					vec3 color = rayTrace(ray, *sampler, &firstHit, cachedHit);
+
+					//http://stackoverflow.com/questions/22999487/update-the-average-of-a-continuous-sequence-of-numbers-in-constant-time
+					// add to average
+					m_buffer->setPixelColor3(x, y,
+						(float(sampleIndex) * m_buffer->getPixelColor3(x, y) + color) / float(sampleIndex + 1));
+					m_convergence.addSample(x, y, color);
+					m_denoiser.addFeatures(x, y, sampleIndex, firstHit.features);
+					m_reprojection.addFirstHit(x, y, firstHit.isHit, firstHit.position);
+				}
 			}
 		});
 
+		const int tileCount = (int)m_tiles.size();
+		m_convergedTilePercentage = (tileCount > 0) ? 100 * convergedTileCount / tileCount : 0;
+		// Nothing more to do until something changes, if even the revisit didn't find any noisy tiles.
+		m_isConverged = threshold > 0.0f && isRevisitPass && convergedTileCount == tileCount;
 		m_currentSample++;
-		m_frameReady = true;
 	}
 }
 
+void RayTracer::reprojectSamples()
+{
+	const int width = m_buffer->width();
+	const int height = m_buffer->height();
+
+	// Nothing to keep yet, or the buffers are out of date.
+	if (!m_hasRenderCamera ||
+		m_convergence.width() != width || m_convergence.height() != height ||
+		m_denoiser.width() != width || m_denoiser.height() != height ||
+		m_reprojection.width() != width || m_reprojection.height() != height)
+	{
+		clear();
+		return;
+	}
+
+	const Camera camera = handOverCamera();
+
+	m_previousBuffer = *m_buffer;
+	m_previousConvergence = m_convergence;
+	m_previousDenoiser = m_denoiser;
+	m_previousReprojection = m_reprojection;
+
+	// One ray through the centre of each new pixel finds the surface it sees, which is then looked up from
+	// the old view. The kept samples have a reduced weight, so that the new samples soon take over.
+	m_renderPool.run(height, [&](int y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			Ray ray = camera.getExactRay((float(x) + 0.5f) / float(width), (float(y) + 0.5f) / float(height));
+			int primitiveIndex = -1;
+			HitRecord record;
+			bool isHit = hitScene(ray, rayMaxLength(), primitiveIndex, record);
+
+			int sourceX = 0;
+			int sourceY = 0;
+			if (m_previousReprojection.findHistory(
+					m_renderCamera, isHit, record.point, glm::normalize(ray.direction()), sourceX, sourceY))
+			{
+				m_buffer->setPixelColor3(x, y, m_previousBuffer.getPixelColor3(sourceX, sourceY));
+				m_convergence.copyPixel(m_previousConvergence, sourceX, sourceY, x, y, ReprojectedMaxSamples);
+				m_denoiser.copyFeatures(m_previousDenoiser, sourceX, sourceY, x, y);
+				m_reprojection.copyPixel(m_previousReprojection, sourceX, sourceY, x, y);
+			}
+			else
+			{
+				m_buffer->setPixelColor3(x, y, vec3(0.0f, 0.0f, 0.0f));
+				m_convergence.clearPixel(x, y);
+				m_denoiser.clearFeatures(x, y);
+				m_reprojection.clearPixel(x, y);
+			}
+		}
+	});
+
+	m_renderCamera = camera;
+	m_primaryHits.clear();
+	m_convergedTilePercentage = 0;
+	m_isConverged = false;
+	m_currentSample = 0;
+	m_totalRayTracingTime = -1.0;
+	m_startTime = -1.0f;
+}
+
+void RayTracer::presentFrame()
+{
+	ImageBuffer<float>& frame = m_frames.back();
+	if (frame.width() != m_buffer->width() || frame.height() != m_buffer->height())
+		frame.init(m_buffer->width(), m_buffer->height());
+
+	if (m_isVisualizeConvergence && m_convergence.width() == m_buffer->width() && m_convergence.height() == m_buffer->height())
+	{
+		m_convergence.writeHeatMap(frame, std::max(m_adaptiveThreshold.load(), 0.001f), m_renderPool);
+	}
+	else if (m_isDenoise && m_denoiser.width() == m_buffer->width() && m_denoiser.height() == m_buffer->height())
+	{
+		m_denoiser.denoise(*m_buffer, m_convergence, frame, m_renderPool);
+	}
+	else
+	{
+		frame = *m_buffer;
+	}
+
+	m_frames.publish();
+}
+
 void RayTracer::writeToPng(String filename)
 {
-	std::lock_guard<std::mutex> lock(m_bufferMutex);
 	m_uintBuffer->writeToPng(filename);
 }
 
 void RayTracer::updateImageBuffer()
 {
-	{
-		std::lock_guard<std::mutex> lock(m_bufferMutex);
-		copy8BitImageBuffer(*m_buffer, *m_uintBuffer);
-	}
+	const ImageBuffer<float>& frame = m_frames.front();
+
+	if (frame.width() == m_bigUintBuffer.width() && frame.height() == m_bigUintBuffer.height())
+		m_uintBuffer = &m_bigUintBuffer;
+	else if (frame.width() == m_smallUintBuffer.width() && frame.height() == m_smallUintBuffer.height())
+		m_uintBuffer = &m_smallUintBuffer;
+	else return;
 
+	copy8BitImageBuffer(frame, *m_uintBuffer);
 	m_uintBuffer->updateToNanoVG(m_windowSystem.mainWindow().nanoVG());
 }
 
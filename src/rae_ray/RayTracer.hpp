@@ -4,11 +4,14 @@
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <condition_variable>
 
 #include "nanovg.h"
 
 #include "rae/core/Types.hpp"
 #include "rae/core/ISystem.hpp"
+#include "rae/core/ThreadPool.hpp"
+#include "rae/core/TripleBuffer.hpp"
 
 #include "rae/scene/SceneSystem.hpp"
 
@@ -17,8 +20,18 @@
 #include "rae_ray/Hitable.hpp"
 #include "rae_ray/HitableList.hpp"
 #include "rae_ray/BvhNode.hpp"
+#include "rae_ray/FlatBvh.hpp"
+#include "rae_ray/RenderTiles.hpp"
+#include "rae_ray/Sampler.hpp"
+#include "rae_ray/ConvergenceBuffer.hpp"
+#include "rae_ray/Denoiser.hpp"
+#include "rae_ray/LightList.hpp"
+#include "rae_ray/ReprojectionBuffer.hpp"
+#include "rae_ray/PrimaryHitCache.hpp"
+#include "rae_ray/RenderScene.hpp"
 
 #include "rae/image/ImageBuffer.hpp"
+#include "rae/visual/Camera.hpp"
 
 namespace rae
 {
@@ -27,7 +40,6 @@ class Time;
 class AssetSystem;
 class WindowSystem;
 class SceneSystem;
-class Camera;
 class Material;
 
 using VolumeParent = Id;
@@ -35,6 +47,56 @@ using VolumeChildren = Array<Id>;
 
 #define circleArea(r) (PI*r*r)
 
+// The paths are not terminated with Russian roulette before this many bounces.
+const int RussianRouletteMinBounces = 3;
+// With adaptive sampling, every this many passes the converged tiles are sampled too.
+const int ConvergedTileRevisitPasses = 16;
+
+// What the first ray of a path hit, for the denoiser and for reprojecting the samples.
+struct FirstHit
+{
+	bool isHit = false;
+	vec3 position;
+	DenoiseFeatures features;
+};
+
+// Where a traced entity was, for finding out if its changes can show in the image.
+struct TracedBounds
+{
+	Box box;
+	bool isLight = false;
+};
+
+// What happens to the accumulated samples of the ray tracer after the changes of a frame.
+enum class AccumulationAction
+{
+	Keep,
+	Reproject, // Move the samples to the new view of the camera.
+	Clear
+};
+
+// The changes of a frame, as far as the traced image is concerned.
+struct FrameChanges
+{
+	bool isTransformChanged = false;
+	bool isSelectionChanged = false;
+	bool isCameraChanged = false;
+	bool isVisibleChange = false; // Something changed in the view, or the whole scene was compiled again.
+	bool isSceneChanged = false; // The snapshot of the scene was patched, maybe only outside of the view.
+	// Converged tiles are sampled again after a scene change, but past the samples limit nothing is.
+	bool isSamplesLimitReached = false;
+	bool isFirstCamera = false;
+	bool isViewChanged = false; // The camera moved, turned or zoomed. Otherwise only its lens changed.
+	float aperture = 0.0f;
+	bool isReprojection = true;
+};
+
+// The camera is refocused when the scene or the camera changes. The selection only moves the focus
+// when focusing on the selection is enabled, because refocusing throws away the samples when there's an aperture.
+bool isAutoFocusNeeded(const FrameChanges& changes, bool isFocusOnSelection);
+// The selection doesn't show in the traced image, so it never affects the samples.
+AccumulationAction accumulationAction(const FrameChanges& changes);
+
 class VolumeHierarchySystem
 {
 public:
@@ -68,25 +130,58 @@ public:
 	void showScene(int number);
 	void clearScene();
 
+	// Compiles the spheres and meshes of the scene into a RenderScene, and hands it over to the render thread,
+	// which starts using it before the next pass. Called on the main thread.
 	void updateScene(const Scene& scene);
+	// Removes the destroyed entities and only updates the transforms of the changed ones,
+	// if no entities were created.
+	void updateScene(const Scene& scene, const Array<Id>& changedIds, const Array<Id>& destroyedIds);
+
+	// Remembers the destroyed entities, so that the next update removes them from the traced scene.
+	// Creating other entities on the same frame can keep the count the same, so it can't be relied on.
+	void destroyEntities(const Array<Id>& entities) override;
 
 	UpdateStatus update() override;
 	void updateDebugTexts();
 
+	// Renders passes over the image and presents them, until the thread is stopped. Sleeps while there's
+	// nothing to render, until one of the requests wakes it up.
 	void updateRenderThread();
 
 	void renderAllAtOnce();
 	void renderSamples();
+	// Writes the final image of the current samples (denoised or a debug view) to the back frame and hands it over
+	// to the main thread. Called on the render thread after each pass.
+	void presentFrame();
+	// Converts the latest presented frame to the 8 bit image which is shown. Called on the main thread.
 	void updateImageBuffer();
 	void renderNanoVG(NVGcontext* vg,  float x, float y, float w, float h);
 	void render3D(const Scene& scene, const Window& window, RenderSystem& renderSystem) const;
 
 	void autoFocus();
 
-	vec3 rayTrace(const Ray& ray, int depth = 0);
+	// Traces a path from the ray through the scene, bouncing up to m_bouncesLimit times.
+	// The sampler has been started for the pixel sample, and gives the numbers for the bounces.
+	// The first hit is written to outFirstHit, if given. With a cachedHit, the first hit is taken from it
+	// if it has been traced already, and otherwise traced and stored to it.
+	vec3 rayTrace(
+		const Ray& primaryRay,
+		Sampler& sampler,
+		FirstHit* outFirstHit = nullptr,
+		CachedHit* cachedHit = nullptr);
+	// Finds the closest hit of the ray in the render scene.
+	bool hitScene(const Ray& ray, float maxDistance, int& outPrimitive, HitRecord& outRecord);
+	// Samples a direction towards one of the lights from a diffuse hit and traces a shadow ray. Returns the
+	// reflected light, weighted for multiple importance sampling against the scattering of the material.
+	vec3 sampleDirectLight(const HitRecord& record, Sampler& sampler, int bounce);
 	vec3 sky(const Ray& ray);
 
 	void requestClear(); // Ask for buffer and rendering state to be cleared on start of next update.
+	void requestPresent(); // Ask for the current samples to be presented again, e.g. for a different debug view.
+	// Ask for the samples to be moved to the view of the current camera, which is cheaper than starting over.
+	void requestReproject();
+	// Ask for the converged tiles to be checked again, e.g. against a lower threshold. Keeps the samples.
+	void requestResample();
 	void requestToggleBufferQuality();
 	void toggleBufferQuality(); // ideally protected, but request doesn't work currently.
 
@@ -101,43 +196,167 @@ public:
 
 	void toggleVisualizeFocusDistance() { m_isVisualizeFocusDistance = !m_isVisualizeFocusDistance; }
 
-	ImageBuffer<float>& imageBuffer() { return *m_buffer; }
+	// The 8 bit image which is shown. Only for the main thread.
 	ImageBuffer<uint8_t>& uintBuffer() { return *m_uintBuffer; }
 	void writeToPng(String filename);
 
 	void plusBounces(int delta = 1);
 	void minusBounces(int delta = 1);
 
+	// Mixed into the random seeds of the pixel samples. Renders with the same seed are identical.
+	uint64_t randomSeed() const { return m_randomSeed; }
+	void setRandomSeed(uint64_t seed) { m_randomSeed = seed; }
+
+	// Adaptive sampling skips the tiles where the relative error of all the pixels is below the threshold.
+	// 0 disables it.
+	float adaptiveThreshold() const { return m_adaptiveThreshold; }
+	void setAdaptiveThreshold(float threshold);
+	void toggleVisualizeConvergence() { m_isVisualizeConvergence = !m_isVisualizeConvergence; requestPresent(); }
+
+	// Next event estimation for the diffuse materials. Without it, light only arrives when a scattered ray
+	// happens to hit a light, which is slow to converge for small lights.
+	bool isLightSampling() const { return m_isLightSampling; }
+	void toggleLightSampling() { m_isLightSampling = !m_isLightSampling; requestClear(); }
+
+	// When only the camera moves, the samples of the pixels which still see the same surface are kept.
+	// Otherwise the rendering starts over on every move.
+	bool isReprojection() const { return m_isReprojection; }
+	void toggleReprojection() { m_isReprojection = !m_isReprojection; }
+
+	// Focuses the camera on the selected entity instead of the middle of the view. Off by default, because
+	// with an aperture, selecting something else then starts the rendering over.
+	bool isFocusOnSelection() const { return m_isFocusOnSelection; }
+	void toggleFocusOnSelection() { m_isFocusOnSelection = !m_isFocusOnSelection; }
+
+	// Reuses the first hits of the camera rays between the passes. Only used while the camera has no aperture,
+	// and not in the fast mode. The jitter is limited to the strata of the cache while it's used.
+	bool isPrimaryHitCache() const { return m_isPrimaryHitCache; }
+	void togglePrimaryHitCache() { m_isPrimaryHitCache = !m_isPrimaryHitCache; requestClear(); }
+
+	// Shows the image through the denoiser. The samples are still accumulated without it.
+	bool isDenoise() const { return m_isDenoise; }
+	void toggleDenoise() { m_isDenoise = !m_isDenoise; requestPresent(); }
+
+	SamplerType samplerType() const { return m_samplerType; }
+	void setSamplerType(SamplerType type);
+	void nextSamplerType();
+
+	TileOrder tileOrder() const { return m_tileOrder; }
+	// Takes effect from the next sample.
+	void setTileOrder(TileOrder order) { m_tileOrder = order; }
+	void nextTileOrder();
+
 protected:
 
 	void checkShouldStartRenderThread();
 
+	// The bounds of a primitive of m_compiledScene.
+	TracedBounds getTracedBounds(int primitiveIndex) const;
+	// Fills m_tracedBounds from all of m_compiledScene, after it has been compiled.
+	void resetTracedBounds();
+	// Updates m_tracedBounds from the transforms which changed on this frame, removes the destroyed entities,
+	// and when the entity count changed, the ones which aren't in m_compiledScene anymore. Returns true if any
+	// of the changes can show in the image: the entity was or is in the view, or it is a light.
+	bool updateChangedBounds(
+		const Scene& scene,
+		const Array<Id>& changedIds,
+		const Array<Id>& destroyedIds,
+		bool isCountChanged);
+
+	void requestSceneUpdate() { m_requestSceneUpdate = true; wakeRenderThread(); }
+	// Copies m_compiledScene for the render thread. isCompiled tells that it was compiled instead of patched,
+	// so that the primitive indices have changed.
+	void handOverScene(bool isCompiled);
+	// Starts using the latest handed over scene. Called on the render thread.
+	void takeScene();
+	// The latest camera from the main thread.
+	Camera handOverCamera();
+
+	bool isSamplesLimitReached() const;
+	// True when the sample limit is reached, or when all the tiles were still converged on a revisit pass.
+	bool isRenderingDone() const;
+	bool hasRenderWork() const;
+	void wakeRenderThread();
+
 	void clear();
+	// Moves the samples from the view of m_renderCamera to the view of the current camera. The pixels which now see
+	// something which was hidden or outside of the old view, or which were on an edge, are cleared.
+	void reprojectSamples();
+
+	// Splits the buffer into tiles and hands them out to the render pool one at a time, so that the threads
+	// which get cheap tiles (e.g. just sky) pick up more of them. Blocks until all the tiles are rendered.
+	// The tiles don't overlap, so renderTile can write the pixels of its tile to the per pixel buffers
+	// (the accumulated colors, ConvergenceBuffer, ReprojectionBuffer, Denoiser and PrimaryHitCache) without locks,
+	// as long as it writes no pixels outside of the tile.
+	void renderTiles(const std::function<void(const Tile&)>& renderTile);
 
 	bool m_isInfoText = true;
 	bool m_isFastMode = false;
 	bool m_isVisualizeFocusDistance = true;
+	bool m_isReprojection = true;
+	bool m_isFocusOnSelection = false;
+	std::atomic<bool> m_isVisualizeConvergence;
+	std::atomic<bool> m_isDenoise;
+	std::atomic<bool> m_isLightSampling;
+	std::atomic<bool> m_isPrimaryHitCache;
 
 	double m_switchTime = 5.0f; // time to switch to big buffer rendering in seconds
 
-	std::mutex				m_bufferMutex;
-	std::atomic<bool>		m_frameReady;
 	std::atomic<bool>		m_requestClear;
 	std::atomic<bool>		m_requestToggleBuffer;
+	std::atomic<bool>		m_requestSceneUpdate;
+	std::atomic<bool>		m_requestPresent;
+	std::atomic<bool>		m_requestReproject;
+	std::atomic<bool>		m_requestResample;
+
+	// The render thread sleeps on this while it has nothing to do.
+	std::mutex				m_renderWakeMutex;
+	std::condition_variable	m_renderWakeUp;
 
+	// The accumulated samples. Only touched by the render thread.
 	ImageBuffer<float>		m_smallBuffer;
 	ImageBuffer<float>		m_bigBuffer;
 	ImageBuffer<float>*		m_buffer = nullptr;
 
+	// The presented frames, from the render thread to the main thread. The main thread never waits for a pass
+	// to finish, it just shows the latest frame.
+	TripleBuffer<ImageBuffer<float>> m_frames;
+
+	// Only touched by the main thread. m_uintBuffer is the one which matches the size of the latest frame.
 	ImageBuffer<uint8_t>	m_smallUintBuffer;
 	ImageBuffer<uint8_t>	m_bigUintBuffer;
 	ImageBuffer<uint8_t>*	m_uintBuffer = nullptr;
 
+	// The sample counts and variances of the pixels of m_buffer.
+	ConvergenceBuffer		m_convergence;
+	std::atomic<float>		m_adaptiveThreshold;
+	std::atomic<int>		m_convergedTilePercentage; // Of the last pass, for the debug texts.
+	std::atomic<bool>		m_isConverged;
+
+	// The first hit albedos and normals of m_buffer.
+	Denoiser				m_denoiser;
+	// The first hit positions of m_buffer.
+	ReprojectionBuffer		m_reprojection;
+	// The first hits of the camera rays of m_renderCamera. Cleared with the samples.
+	PrimaryHitCache			m_primaryHits;
+
+	// The camera which the samples of m_buffer were taken with. Taken from the scene on the first pass after
+	// a clear, and updated by reprojectSamples, so that the camera doesn't wobble while the samples stay put.
+	Camera					m_renderCamera;
+	bool					m_hasRenderCamera = false;
+
+	// Copies of the above from before the camera moved, for reprojectSamples to read from.
+	ImageBuffer<float>		m_previousBuffer;
+	ConvergenceBuffer		m_previousConvergence;
+	Denoiser				m_previousDenoiser;
+	ReprojectionBuffer		m_previousReprojection;
+
 	int m_allAtOnceSamplesLimit = 2000;
 	int m_samplesLimit = 0;
 	int m_bouncesLimit = 50;
 
-	int m_currentSample = 0;
+	std::atomic<int> m_currentSample; // Number of passes over the image. With adaptive sampling the pixels can have fewer samples.
+	uint64_t m_randomSeed = 0;
 	double m_totalRayTracingTime = -1.0;
 
 	// for renderAllAtOnce:
@@ -152,9 +371,37 @@ protected:
 	HitableList		m_world;
 	BvhNode			m_tree;
 
+	// The scene is compiled and patched on the main thread, and copied over to the render thread.
+	RenderScene		m_compiledScene;
+	int				m_compiledTransformCount = 0;
+	Array<Id>		m_destroyedIds; // Since the last update.
+	bool			m_isSceneCompiled = false;
+	bool			m_isCameraHandedOver = false;
+
+	std::mutex		m_handOverMutex;
+	RenderScene		m_handOverScene;
+	bool			m_isHandOverCompiled = false;
+	Camera			m_handOverCamera;
+
+	// Only for the render thread.
+	RenderScene		m_renderScene;
+	LightList		m_lights; // The spheres with a light material, from the render scene.
+
+	// The last known bounds of the traced entities, for finding out where they moved from. Only for the main thread.
+	Map<Id, TracedBounds> m_tracedBounds;
+
 	NVGpaint m_imgPaint;
 
-	bool m_renderThreadActive = false;
+	ThreadPool				m_renderPool;
+	std::atomic<TileOrder>	m_tileOrder;
+	std::atomic<SamplerType> m_samplerType;
+	// The tiles of the current buffer, recreated by renderTiles when the buffer or the order changes.
+	Array<Tile>				m_tiles;
+	TileOrder				m_tilesOrder = TileOrder::Scanline;
+	int						m_tilesWidth = 0;
+	int						m_tilesHeight = 0;
+
+	std::atomic<bool> m_renderThreadActive;
 	std::thread m_renderThread;
 };
 
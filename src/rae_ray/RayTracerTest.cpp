@@ -0,0 +1,82 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/RayTracer.hpp"
+
+using namespace rae;
+
+SCENARIO("RayTracer accumulation unittest", "[rae][RayTracer]")
+{
+	GIVEN( "a frame where only the selection changed, with an aperture" )
+	{
+		FrameChanges changes;
+		changes.isSelectionChanged = true;
+		changes.aperture = 0.1f;
+
+		THEN( "the camera isn't refocused and the samples are kept" )
+		{
+			REQUIRE_FALSE( isAutoFocusNeeded(changes, false) );
+			REQUIRE( accumulationAction(changes) == AccumulationAction::Keep );
+		}
+
+		THEN( "the camera is refocused when focusing on the selection" )
+		{
+			REQUIRE( isAutoFocusNeeded(changes, true) );
+		}
+	}
+
+	GIVEN( "a frame where only the focus of the camera changed" )
+	{
+		FrameChanges changes;
+		changes.isCameraChanged = true;
+		changes.isViewChanged = false;
+
+		THEN( "the samples are kept without an aperture" )
+		{
+			changes.aperture = 0.0f;
+			REQUIRE( accumulationAction(changes) == AccumulationAction::Keep );
+		}
+
+		THEN( "the samples are cleared, not reprojected, with an aperture" )
+		{
+			changes.aperture = 0.1f;
+			REQUIRE( accumulationAction(changes) == AccumulationAction::Clear );
+		}
+	}
+
+	GIVEN( "a frame where something changed outside of the view" )
+	{
+		FrameChanges changes;
+		changes.isSceneChanged = true;
+
+		THEN( "the samples are kept after the image has converged" )
+		{
+			// The converged tiles are sampled again after the scene changes, so the change fades in.
+			REQUIRE( accumulationAction(changes) == AccumulationAction::Keep );
+		}
+
+		THEN( "the samples are cleared after the samples limit" )
+		{
+			changes.isSamplesLimitReached = true;
+			REQUIRE( accumulationAction(changes) == AccumulationAction::Clear );
+		}
+	}
+
+	GIVEN( "a frame where the camera moved" )
+	{
+		FrameChanges changes;
+		changes.isCameraChanged = true;
+		changes.isViewChanged = true;
+
+		THEN( "the samples are reprojected, or cleared without reprojection" )
+		{
+			REQUIRE( accumulationAction(changes) == AccumulationAction::Reproject );
+			changes.isReprojection = false;
+			REQUIRE( accumulationAction(changes) == AccumulationAction::Clear );
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,335 @@
+#include "rae_ray/RenderScene.hpp"
+
+#include "rae/asset/AssetSystem.hpp"
+#include "rae/scene/Scene.hpp"
+#include "rae/visual/Mesh.hpp"
+
+using namespace rae;
+
+void RenderScene::clear()
+{
+	m_primitives.clear();
+	m_bounds.clear();
+	m_inverseTransforms.clear();
+	m_meshes.clear();
+	m_materials.clear();
+	m_primitiveIndices.clear();
+	m_meshIndices.clear();
+	m_materialIndices.clear();
+	m_bvh.clear();
+	m_leaves.clear();
+	m_nodeLeaves.clear();
+}
+
+void RenderScene::compile(const Scene& scene, const AssetSystem& assetSystem)
+{
+	compile(scene.transformSystem(), scene.assetLinkSystem(), assetSystem);
+}
+
+void RenderScene::compile(
+	const TransformSystem& transformSystem,
+	const AssetLinkSystem& assetLinkSystem,
+	const AssetSystem& assetSystem)
+{
+	clear();
+
+	query<Box>(transformSystem.boxes(), [&](Id id, const Box&)
+	{
+		RenderPrimitive primitive;
+		Box bounds;
+		if (!updatePrimitive(transformSystem, assetLinkSystem, assetSystem, id, true, primitive, bounds))
+			return;
+
+		primitive.id = id;
+		primitive.materialIndex = addMaterial(assetLinkSystem, assetSystem, id);
+
+		m_primitiveIndices[id] = (int)m_primitives.size();
+		m_primitives.emplace_back(primitive);
+		m_bounds.emplace_back(bounds);
+	});
+
+	buildBvh();
+}
+
+bool RenderScene::patch(const Scene& scene, const AssetSystem& assetSystem, const Array<Id>& changedIds)
+{
+	return patch(scene.transformSystem(), scene.assetLinkSystem(), assetSystem, changedIds);
+}
+
+bool RenderScene::patch(
+	const TransformSystem& transformSystem,
+	const AssetLinkSystem& assetLinkSystem,
+	const AssetSystem& assetSystem,
+	const Array<Id>& changedIds)
+{
+	for (Id id : changedIds)
+	{
+		auto found = m_primitiveIndices.find(id);
+		if (found == m_primitiveIndices.end())
+		{
+			bool isTraced = transformSystem.hasBox(id) &&
+				(transformSystem.hasSphere(id) ||
+				(assetLinkSystem.hasMeshLink(id) && assetSystem.getMesh(assetLinkSystem.getMeshLink(id)).triangles()));
+			if (isTraced)
+				return false;
+			continue;
+		}
+
+		const int index = found->second;
+		if (!updatePrimitive(
+			transformSystem, assetLinkSystem, assetSystem, id, false, m_primitives[index], m_bounds[index]))
+			return false;
+	}
+
+	buildBvh();
+	return true;
+}
+
+bool RenderScene::remove(const Array<Id>& destroyedIds)
+{
+	bool isRemoved = false;
+	for (Id id : destroyedIds)
+	{
+		auto found = m_primitiveIndices.find(id);
+		if (found == m_primitiveIndices.end())
+			continue;
+
+		const int index = found->second;
+		m_primitiveIndices.erase(found);
+
+		const int lastIndex = (int)m_primitives.size() - 1;
+		if (index != lastIndex)
+		{
+			m_primitives[index] = m_primitives[lastIndex];
+			m_bounds[index] = m_bounds[lastIndex];
+			m_primitiveIndices[m_primitives[index].id] = index;
+		}
+		m_primitives.pop_back();
+		m_bounds.pop_back();
+		isRemoved = true;
+	}
+
+	// The materials, meshes and transform slots of the removed primitives stay until the next compile.
+	if (isRemoved)
+		buildBvh();
+	return isRemoved;
+}
+
+int RenderScene::addMaterial(const Material& material)
+{
+	m_materials.emplace_back(material);
+	return (int)m_materials.size() - 1;
+}
+
+void RenderScene::addSphere(Id id, const vec3& center, float radius, int materialIndex)
+{
+	RenderPrimitive primitive;
+	primitive.id = id;
+	primitive.materialIndex = materialIndex;
+	primitive.sphere.centerX = center.x;
+	primitive.sphere.centerY = center.y;
+	primitive.sphere.centerZ = center.z;
+	primitive.sphere.radius = radius;
+
+	m_primitiveIndices[id] = (int)m_primitives.size();
+	m_primitives.emplace_back(primitive);
+	m_bounds.emplace_back(center - vec3(radius), center + vec3(radius));
+}
+
+void RenderScene::buildBvh()
+{
+	m_bvh.build(m_bounds, HitBatchWidth);
+
+	m_leaves.clear();
+	m_nodeLeaves.assign(m_bvh.nodes().size(), std::make_pair(0, 0));
+	for (int nodeIndex = 0; nodeIndex < (int)m_bvh.nodes().size(); ++nodeIndex)
+	{
+		const FlatBvhNode& node = m_bvh.nodes()[nodeIndex];
+		if (!node.isLeaf())
+			continue;
+
+		const int first = (int)m_leaves.size();
+		m_leaves.emplace_back();
+		for (int i = 0; i < node.count; ++i)
+		{
+			const int index = m_bvh.leafItem(node, i);
+			const RenderPrimitive& primitive = m_primitives[index];
+			RenderLeaf* leaf = &m_leaves.back();
+			switch (primitive.type)
+			{
+				case PrimitiveType::Sphere:
+					if (leaf->spheres.count == HitBatchWidth)
+					{
+						m_leaves.emplace_back();
+						leaf = &m_leaves.back();
+					}
+					leaf->spherePrimitives[leaf->spheres.count] = index;
+					leaf->spheres.add(primitive.sphereCenter(), primitive.sphere.radius);
+					break;
+				case PrimitiveType::MeshInstance:
+					if (leaf->meshBounds.count == HitBatchWidth)
+					{
+						m_leaves.emplace_back();
+						leaf = &m_leaves.back();
+					}
+					leaf->meshPrimitives[leaf->meshBounds.count] = index;
+					leaf->meshBounds.add(m_bounds[index].min(), m_bounds[index].max());
+					break;
+			}
+		}
+
+		m_nodeLeaves[nodeIndex] = std::make_pair(first, (int)m_leaves.size() - first);
+	}
+}
+
+bool RenderScene::updatePrimitive(
+	const TransformSystem& transformSystem,
+	const AssetLinkSystem& assetLinkSystem,
+	const AssetSystem& assetSystem,
+	Id id,
+	bool isNew,
+	RenderPrimitive& primitive,
+	Box& outBounds)
+{
+	if (!transformSystem.hasBox(id) || !transformSystem.hasWorldTransform(id))
+		return false;
+
+	const Transform& transform = transformSystem.getWorldTransform(id);
+
+	if (transformSystem.hasSphere(id))
+	{
+		if (!isNew && primitive.type != PrimitiveType::Sphere)
+			return false;
+
+		float radius = transformSystem.getBox(id).radius() * transform.scale.x;
+		primitive.type = PrimitiveType::Sphere;
+		primitive.sphere.centerX = transform.position.x;
+		primitive.sphere.centerY = transform.position.y;
+		primitive.sphere.centerZ = transform.position.z;
+		primitive.sphere.radius = radius;
+		outBounds = Box(transform.position - vec3(radius), transform.position + vec3(radius));
+		return true;
+	}
+
+	if (assetLinkSystem.hasMeshLink(id))
+	{
+		if (!isNew && primitive.type != PrimitiveType::MeshInstance)
+			return false;
+
+		if (isNew)
+		{
+			Id meshId = assetLinkSystem.getMeshLink(id);
+			// A mesh which failed to load has nothing to hit.
+			if (!assetSystem.getMesh(meshId).triangles())
+				return false;
+
+			auto found = m_meshIndices.find(meshId);
+			if (found == m_meshIndices.end())
+			{
+				found = m_meshIndices.emplace(meshId, (int)m_meshes.size()).first;
+				m_meshes.emplace_back(assetSystem.getMesh(meshId).triangles());
+			}
+
+			primitive.type = PrimitiveType::MeshInstance;
+			primitive.mesh.meshIndex = found->second;
+			primitive.mesh.transformIndex = (int)m_inverseTransforms.size();
+			m_inverseTransforms.emplace_back();
+		}
+
+		m_inverseTransforms[primitive.mesh.transformIndex] = transformSystem.getInverseWorldMatrix(id);
+		outBounds = m_meshes[primitive.mesh.meshIndex]->aabb;
+		outBounds.transform(transform);
+		return true;
+	}
+
+	return false;
+}
+
+int RenderScene::addMaterial(const AssetLinkSystem& assetLinkSystem, const AssetSystem& assetSystem, Id id)
+{
+	// The entities without a material share a grey one, under the InvalidId.
+	Id materialId = assetLinkSystem.hasMaterialLink(id) ? assetLinkSystem.getMaterialLink(id) : InvalidId;
+	auto found = m_materialIndices.find(materialId);
+	if (found != m_materialIndices.end())
+		return found->second;
+
+	const int index = (int)m_materials.size();
+	m_materialIndices[materialId] = index;
+	if (materialId != InvalidId)
+		m_materials.emplace_back(assetSystem.getMaterial(materialId));
+	else m_materials.emplace_back("Default", Color3(0.5f, 0.5f, 0.5f));
+	return index;
+}
+
+bool RenderScene::hit(const Ray& ray, float tMin, float tMax, int& outPrimitive, HitRecord& outRecord) const
+{
+	bool isHit = false;
+	float closestSoFar = tMax;
+
+	const vec3 origin = ray.origin();
+	const vec3 direction = ray.direction();
+	const vec3 invDirection = 1.0f / direction;
+
+	// Front to back through the BVH. The closestSoFar culls the nodes behind the closest hit.
+	m_bvh.traverseLeaves(ray, tMin, closestSoFar, [&](int nodeIndex)
+	{
+		const std::pair<int, int>& range = m_nodeLeaves[nodeIndex];
+		for (int leafIndex = range.first; leafIndex < range.first + range.second; ++leafIndex)
+		{
+			const RenderLeaf& leaf = m_leaves[leafIndex];
+
+			if (leaf.spheres.count > 0)
+			{
+				// Only the t is kept for now, and the rest of the record is filled in if a sphere stays the closest.
+				float t;
+				int lane = m_isSimd
+					? hitSpheres(leaf.spheres, origin, direction, tMin, closestSoFar, t)
+					: hitSpheresScalar(leaf.spheres, origin, direction, tMin, closestSoFar, t);
+				if (lane != -1)
+				{
+					closestSoFar = t;
+					outPrimitive = leaf.spherePrimitives[lane];
+					outRecord.t = t;
+					isHit = true;
+				}
+			}
+
+			if (leaf.meshBounds.count > 0)
+			{
+				float entries[HitBatchWidth];
+				int boxMask = m_isSimd
+					? hitBoxes(leaf.meshBounds, origin, invDirection, tMin, closestSoFar, entries)
+					: hitBoxesScalar(leaf.meshBounds, origin, invDirection, tMin, closestSoFar, entries);
+				for (int i = 0; i < leaf.meshBounds.count; ++i)
+				{
+					if (!(boxMask & (1 << i)) || entries[i] > closestSoFar)
+						continue;
+
+					const int index = leaf.meshPrimitives[i];
+					const RenderPrimitive& primitive = m_primitives[index];
+					HitRecord record;
+					if (m_meshes[primitive.mesh.meshIndex]->hit(
+						m_inverseTransforms[primitive.mesh.transformIndex], ray, tMin, closestSoFar, record))
+					{
+						closestSoFar = record.t;
+						outPrimitive = index;
+						outRecord = record;
+						isHit = true;
+					}
+				}
+			}
+		}
+	});
+
+	if (!isHit)
+		return false;
+
+	const RenderPrimitive& primitive = m_primitives[outPrimitive];
+	if (primitive.type == PrimitiveType::Sphere)
+	{
+		outRecord.point = ray.getPointAt(outRecord.t);
+		outRecord.normal = (outRecord.point - primitive.sphereCenter()) / primitive.sphere.radius;
+	}
+	outRecord.material = &m_materials[primitive.materialIndex];
+	return true;
+}
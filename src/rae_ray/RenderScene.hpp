@@ -0,0 +1,161 @@
+#pragma once
+
+#include <memory>
+
+#include "rae/core/Types.hpp"
+#include "rae/visual/Box.hpp"
+#include "rae/visual/Material.hpp"
+#include "rae/visual/Ray.hpp"
+#include "rae_ray/FlatBvh.hpp"
+#include "rae_ray/HitKernels.hpp"
+#include "rae_ray/HitRecord.hpp"
+
+namespace rae
+{
+
+class Scene;
+class TransformSystem;
+class AssetLinkSystem;
+class AssetSystem;
+struct MeshTriangles;
+
+enum class PrimitiveType : uint8_t
+{
+	Sphere,
+	MeshInstance
+};
+
+// A traced thing of the scene. Plain floats and indices, so that the primitives pack densely into an array.
+struct RenderPrimitive
+{
+	struct SphereData
+	{
+		float centerX;
+		float centerY;
+		float centerZ;
+		float radius;
+	};
+
+	struct MeshData
+	{
+		int meshIndex; // To RenderScene::meshes.
+		int transformIndex; // To RenderScene::inverseTransforms.
+	};
+
+	PrimitiveType type = PrimitiveType::Sphere;
+	int materialIndex = 0; // To RenderScene::materials.
+	Id id = InvalidId; // The entity, for the lights and debugging.
+
+	union
+	{
+		SphereData sphere;
+		MeshData mesh;
+	};
+
+	RenderPrimitive() : sphere() {}
+
+	vec3 sphereCenter() const { return vec3(sphere.centerX, sphere.centerY, sphere.centerZ); }
+};
+
+// The primitives of a BVH leaf, split by type into batches for the SIMD kernels. The leaves are built to fit in
+// one, but the ones which the BVH can't split (e.g. at the maximum depth) can take a few.
+struct RenderLeaf
+{
+	SphereBatch	spheres;
+	int			spherePrimitives[HitBatchWidth];
+	BoxBatch	meshBounds; // The world space bounds of the mesh instances, tested before the meshes themselves.
+	int			meshPrimitives[HitBatchWidth];
+};
+
+// A snapshot of the traced parts of a Scene, compiled on the main thread and handed over to the render thread,
+// so that the render thread never reads the tables which the main thread is modifying. The spheres and the mesh
+// instances are in one array with a BVH over them, the inverse world matrices of the mesh instances are packed
+// next to each other, and the materials are copied to a dense array. The leaves of the BVH are packed into
+// batches, so that a ray is tested against all the spheres of a leaf at once with the SIMD kernels. The triangles
+// of the meshes are shared with the asset system through MeshTriangles, which stay alive and in place while the
+// snapshot uses them, even if the Mesh is moved in its Table or rebuilt.
+// Usage example:
+// renderScene.compile(scene, assetSystem); // On the main thread.
+// if (!renderScene.patch(scene, assetSystem, changedIds)) // When the transforms change.
+//     renderScene.compile(scene, assetSystem);
+// renderScene.remove(destroyedIds); // When entities are destroyed.
+// renderScene.hit(ray, 0.001f, FLT_MAX, primitiveIndex, record); // On the render thread, on a copy.
+class RenderScene
+{
+public:
+	void clear();
+	// Builds everything from the scene.
+	void compile(const Scene& scene, const AssetSystem& assetSystem);
+	void compile(
+		const TransformSystem& transformSystem,
+		const AssetLinkSystem& assetLinkSystem,
+		const AssetSystem& assetSystem);
+	// For filling the snapshot without a Scene, e.g. in the tests and benchmarks. Call buildBvh after adding.
+	int addMaterial(const Material& material);
+	void addSphere(Id id, const vec3& center, float radius, int materialIndex);
+	void buildBvh();
+	// Updates the transforms of the changed entities and rebuilds the BVH, which is much cheaper than compile.
+	// Returns false if one of the changed entities should be traced but isn't in the snapshot yet, and then
+	// compile is needed.
+	bool patch(const Scene& scene, const AssetSystem& assetSystem, const Array<Id>& changedIds);
+	bool patch(
+		const TransformSystem& transformSystem,
+		const AssetLinkSystem& assetLinkSystem,
+		const AssetSystem& assetSystem,
+		const Array<Id>& changedIds);
+	// Drops the primitives of the destroyed entities and rebuilds the BVH. The last primitives are moved into
+	// the freed places, so the indices of the others can change. Returns false if none of them were traced.
+	bool remove(const Array<Id>& destroyedIds);
+
+	bool isEmpty() const { return m_primitives.empty(); }
+	int primitiveCount() const { return (int)m_primitives.size(); }
+	const RenderPrimitive& primitive(int index) const { return m_primitives[index]; }
+	// The index of the primitive of the entity, or -1 if the entity isn't traced.
+	int findPrimitive(Id id) const
+	{
+		auto found = m_primitiveIndices.find(id);
+		return found != m_primitiveIndices.end() ? found->second : -1;
+	}
+	const Material& material(int index) const { return m_materials[index]; }
+	// The world space bounds of the primitive.
+	const Box& bounds(int index) const { return m_bounds[index]; }
+
+	// Whether the leaves are tested with the SIMD kernels or with their scalar fallbacks. Only worth turning off
+	// for comparing the two, as the SIMD kernels are the scalar ones when there's no SSE or AVX.
+	bool isSimd() const { return m_isSimd; }
+	void setSimd(bool enable) { m_isSimd = enable; }
+
+	// Finds the closest hit of the ray through the BVH. The material of the record is set too.
+	bool hit(const Ray& ray, float tMin, float tMax, int& outPrimitive, HitRecord& outRecord) const;
+
+protected:
+	// Fills the geometry of the primitive from the world transform of the entity. A new mesh instance gets a new
+	// transform slot. Returns false if the entity isn't traced, or has changed its type.
+	bool updatePrimitive(
+		const TransformSystem& transformSystem,
+		const AssetLinkSystem& assetLinkSystem,
+		const AssetSystem& assetSystem,
+		Id id,
+		bool isNew,
+		RenderPrimitive& primitive,
+		Box& outBounds);
+	int addMaterial(const AssetLinkSystem& assetLinkSystem, const AssetSystem& assetSystem, Id id);
+
+	Array<RenderPrimitive>	m_primitives;
+	Array<Box>				m_bounds; // For each primitive.
+	Array<mat4>				m_inverseTransforms;
+	Array<std::shared_ptr<const MeshTriangles>> m_meshes;
+	Array<Material>			m_materials;
+
+	Map<Id, int>			m_primitiveIndices; // From the entity.
+	Map<Id, int>			m_meshIndices; // From the mesh asset.
+	Map<Id, int>			m_materialIndices; // From the material asset.
+
+	FlatBvh					m_bvh; // The item indices are the primitive indices.
+	Array<RenderLeaf>		m_leaves;
+	// For each BVH node, the first index to m_leaves and the number of them, which is 0 for the inner nodes.
+	Array<std::pair<int, int>> m_nodeLeaves;
+	bool					m_isSimd = isSimdAvailable();
+};
+
+} // namespace rae
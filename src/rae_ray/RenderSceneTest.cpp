@@ -0,0 +1,172 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/RenderScene.hpp"
+#include "rae/asset/AssetLinkSystem.hpp"
+#include "rae/asset/AssetSystem.hpp"
+#include "rae/core/Time.hpp"
+#include "rae/scene/TransformSystem.hpp"
+
+using namespace rae;
+
+SCENARIO("RenderScene unittest", "[rae][RenderScene]")
+{
+	GIVEN( "a scene with a sphere compiled into a render scene" )
+	{
+		Time time;
+		AssetSystem assetSystem(time, nullptr);
+		AssetLinkSystem assetLinkSystem;
+		TransformSystem transformSystem;
+
+		// Like Scene::createSphere, but without a material, so that the default one is used.
+		const Id sphereId = 2;
+		transformSystem.addTransform(sphereId, Transform(vec3(0.0f, 0.0f, 0.0f), qua(), vec3(2.0f)));
+		transformSystem.addBox(sphereId, Box(vec3(-0.5f), vec3(0.5f)));
+		transformSystem.addSphere(sphereId);
+		transformSystem.update();
+
+		RenderScene renderScene;
+		renderScene.compile(transformSystem, assetLinkSystem, assetSystem);
+
+		const Ray ray(vec3(0.0f, 0.0f, 10.0f), vec3(0.0f, 0.0f, -1.0f));
+
+		THEN( "the sphere is hit" )
+		{
+			REQUIRE( renderScene.primitiveCount() == 1 );
+			REQUIRE( renderScene.findPrimitive(sphereId) == 0 );
+
+			int primitive = -1;
+			HitRecord record;
+			REQUIRE( renderScene.hit(ray, 0.001f, FLT_MAX, primitive, record) );
+			REQUIRE( primitive == 0 );
+			REQUIRE( record.t == Approx(9.0f) );
+			REQUIRE( record.material != nullptr );
+		}
+
+		WHEN( "the sphere is moved and the render scene is patched" )
+		{
+			transformSystem.setLocalPosition(sphereId, vec3(0.0f, 0.0f, 5.0f));
+			transformSystem.update();
+			REQUIRE( renderScene.patch(transformSystem, assetLinkSystem, assetSystem, Array<Id>{ sphereId }) );
+
+			THEN( "the hit is at the new position" )
+			{
+				int primitive = -1;
+				HitRecord record;
+				REQUIRE( renderScene.hit(ray, 0.001f, FLT_MAX, primitive, record) );
+				REQUIRE( primitive == 0 );
+				REQUIRE( record.t == Approx(4.0f) );
+				REQUIRE( record.normal.z == Approx(1.0f) );
+
+				REQUIRE( renderScene.bounds(0).min().z == Approx(4.0f) );
+			}
+
+			THEN( "a ray through the old position misses" )
+			{
+				int primitive = -1;
+				HitRecord record;
+				Ray oldRay(vec3(0.0f, 10.0f, 0.0f), vec3(0.0f, -1.0f, 0.0f));
+				REQUIRE_FALSE( renderScene.hit(oldRay, 0.001f, FLT_MAX, primitive, record) );
+			}
+		}
+
+		WHEN( "a new sphere is added" )
+		{
+			const Id newId = 3;
+			transformSystem.addTransform(newId, Transform(vec3(5.0f, 0.0f, 0.0f)));
+			transformSystem.addBox(newId, Box(vec3(-0.5f), vec3(0.5f)));
+			transformSystem.addSphere(newId);
+			transformSystem.update();
+
+			THEN( "patching fails, as it needs a compile" )
+			{
+				REQUIRE_FALSE( renderScene.patch(transformSystem, assetLinkSystem, assetSystem, Array<Id>{ newId }) );
+			}
+		}
+
+		WHEN( "an entity links to a mesh which failed to load" )
+		{
+			const Id meshId = 100;
+			assetSystem.addMesh(meshId, Mesh()); // Has no triangles, like after a failed load.
+
+			const Id meshEntityId = 3;
+			transformSystem.addTransform(meshEntityId, Transform(vec3(5.0f, 0.0f, 0.0f)));
+			transformSystem.addBox(meshEntityId, Box(vec3(-0.5f), vec3(0.5f)));
+			assetLinkSystem.addMeshLink(meshEntityId, meshId);
+			transformSystem.update();
+
+			THEN( "it isn't traced, and patching doesn't need a compile for it" )
+			{
+				REQUIRE( renderScene.patch(
+					transformSystem, assetLinkSystem, assetSystem, Array<Id>{ meshEntityId }) );
+
+				renderScene.compile(transformSystem, assetLinkSystem, assetSystem);
+				REQUIRE( renderScene.primitiveCount() == 1 );
+				REQUIRE( renderScene.findPrimitive(meshEntityId) == -1 );
+			}
+		}
+
+		WHEN( "the sphere is destroyed and removed, with an untraced entity" )
+		{
+			const Id untracedId = 3;
+			REQUIRE( renderScene.remove(Array<Id>{ sphereId, untracedId }) );
+
+			THEN( "the sphere isn't hit anymore" )
+			{
+				REQUIRE( renderScene.isEmpty() );
+				REQUIRE( renderScene.findPrimitive(sphereId) == -1 );
+
+				int primitive = -1;
+				HitRecord record;
+				REQUIRE_FALSE( renderScene.hit(ray, 0.001f, FLT_MAX, primitive, record) );
+			}
+
+			THEN( "removing it again does nothing" )
+			{
+				REQUIRE_FALSE( renderScene.remove(Array<Id>{ sphereId }) );
+			}
+		}
+	}
+
+	GIVEN( "a render scene with a row of spheres" )
+	{
+		RenderScene renderScene;
+		const int materialIndex = renderScene.addMaterial(Material());
+		for (Id id = 0; id < 3; ++id)
+		{
+			renderScene.addSphere(id, vec3(float(id) * 3.0f, 0.0f, 0.0f), 1.0f, materialIndex);
+		}
+		renderScene.buildBvh();
+
+		WHEN( "the first sphere is removed" )
+		{
+			REQUIRE( renderScene.remove(Array<Id>{ 0 }) );
+
+			THEN( "the others are still found and hit" )
+			{
+				REQUIRE( renderScene.primitiveCount() == 2 );
+				for (Id id = 1; id < 3; ++id)
+				{
+					const int index = renderScene.findPrimitive(id);
+					REQUIRE( index != -1 );
+					REQUIRE( renderScene.primitive(index).id == id );
+
+					int primitive = -1;
+					HitRecord record;
+					Ray ray(vec3(float(id) * 3.0f, 0.0f, 10.0f), vec3(0.0f, 0.0f, -1.0f));
+					REQUIRE( renderScene.hit(ray, 0.001f, FLT_MAX, primitive, record) );
+					REQUIRE( primitive == index );
+				}
+
+				int primitive = -1;
+				HitRecord record;
+				Ray removedRay(vec3(0.0f, 0.0f, 10.0f), vec3(0.0f, 0.0f, -1.0f));
+				REQUIRE_FALSE( renderScene.hit(removedRay, 0.001f, FLT_MAX, primitive, record) );
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include "rae_ray/RenderTiles.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rae
+{
+
+String toString(TileOrder order)
+{
+	switch (order)
+	{
+		case TileOrder::Scanline:	return "Scanline";
+		case TileOrder::Spiral:		return "Spiral";
+		case TileOrder::Hilbert:	return "Hilbert";
+		default:					return "Unknown";
+	}
+}
+
+int hilbertDistance(int gridSize, int x, int y)
+{
+	int distance = 0;
+	for (int s = gridSize / 2; s > 0; s /= 2)
+	{
+		int rx = (x & s) > 0 ? 1 : 0;
+		int ry = (y & s) > 0 ? 1 : 0;
+		distance += s * s * ((3 * rx) ^ ry);
+
+		// Rotate the quadrant, so that the curve continues from where the previous quadrant ended.
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				x = gridSize - 1 - x;
+				y = gridSize - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return distance;
+}
+
+Array<Tile> createTiles(int imageWidth, int imageHeight, int tileSize, TileOrder order)
+{
+	Array<Tile> tiles;
+	if (imageWidth <= 0 || imageHeight <= 0 || tileSize <= 0)
+		return tiles;
+
+	const int tilesX = (imageWidth + tileSize - 1) / tileSize;
+	const int tilesY = (imageHeight + tileSize - 1) / tileSize;
+
+	tiles.reserve(tilesX * tilesY);
+	for (int ty = 0; ty < tilesY; ++ty)
+	{
+		for (int tx = 0; tx < tilesX; ++tx)
+		{
+			Tile tile;
+			tile.x = tx * tileSize;
+			tile.y = ty * tileSize;
+			tile.width = std::min(tileSize, imageWidth - tile.x);
+			tile.height = std::min(tileSize, imageHeight - tile.y);
+			tiles.emplace_back(tile);
+		}
+	}
+
+	// Sort keys for the tiles, in the scanline order of the tiles.
+	Array<float> keys(tiles.size());
+
+	if (order == TileOrder::Spiral)
+	{
+		// Square rings around the centre tile, and around each ring by angle.
+		const float centerX = float(tilesX - 1) * 0.5f;
+		const float centerY = float(tilesY - 1) * 0.5f;
+		for (int i = 0; i < (int)tiles.size(); ++i)
+		{
+			float dx = float(i % tilesX) - centerX;
+			float dy = float(i / tilesX) - centerY;
+			float ring = std::ceil(std::max(std::abs(dx), std::abs(dy)));
+			// atan2 is in [-pi, pi], so it fits between the rings.
+			keys[i] = ring * 8.0f + std::atan2(dy, dx);
+		}
+	}
+	else if (order == TileOrder::Hilbert)
+	{
+		int gridSize = 1;
+		while (gridSize < tilesX || gridSize < tilesY)
+		{
+			gridSize *= 2;
+		}
+
+		for (int i = 0; i < (int)tiles.size(); ++i)
+		{
+			keys[i] = float(hilbertDistance(gridSize, i % tilesX, i / tilesX));
+		}
+	}
+	else
+	{
+		return tiles;
+	}
+
+	Array<int> indices(tiles.size());
+	for (int i = 0; i < (int)indices.size(); ++i)
+	{
+		indices[i] = i;
+	}
+	std::stable_sort(indices.begin(), indices.end(), [&](int a, int b)
+	{
+		return keys[a] < keys[b];
+	});
+
+	Array<Tile> sortedTiles;
+	sortedTiles.reserve(tiles.size());
+	for (int index : indices)
+	{
+		sortedTiles.emplace_back(tiles[index]);
+	}
+	return sortedTiles;
+}
+
+} // namespace rae
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "rae/core/Types.hpp"
+
+namespace rae
+{
+
+// The order in which the tiles of an image are rendered.
+enum class TileOrder
+{
+	Scanline,	// Row by row from the top left corner.
+	Spiral,		// Outwards from the centre of the image, so the centre converges first.
+	Hilbert,	// Along a Hilbert curve, so consecutive tiles are always next to each other.
+	Count
+};
+
+String toString(TileOrder order);
+
+const int DefaultTileSize = 16;
+
+// A rectangle of pixels rendered as one task. The tiles on the right and bottom edges can be smaller.
+struct Tile
+{
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+};
+
+// Splits the image into tiles of tileSize x tileSize pixels, sorted in the given order.
+Array<Tile> createTiles(int imageWidth, int imageHeight, int tileSize, TileOrder order);
+
+// The distance along a Hilbert curve which fills a gridSize x gridSize grid. gridSize must be a power of two.
+int hilbertDistance(int gridSize, int x, int y);
+
+} // namespace rae
@@ -0,0 +1,76 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/RenderTiles.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace rae;
+
+SCENARIO("RenderTiles unittest", "[rae][RenderTiles]")
+{
+	GIVEN( "an image which is not a multiple of the tile size" )
+	{
+		const int width = 300;
+		const int height = 150;
+
+		for (int i = 0; i < (int)TileOrder::Count; ++i)
+		{
+			TileOrder order = (TileOrder)i;
+			Array<Tile> tiles = createTiles(width, height, 16, order);
+
+			THEN( "every pixel is in exactly one tile, in the " + toString(order) + " order" )
+			{
+				Array<int> coverage(width * height, 0);
+				for (auto&& tile : tiles)
+				{
+					for (int y = tile.y; y < tile.y + tile.height; ++y)
+						for (int x = tile.x; x < tile.x + tile.width; ++x)
+							coverage[y * width + x]++;
+				}
+				REQUIRE(tiles.size() == 19 * 10);
+				REQUIRE(std::count(coverage.begin(), coverage.end(), 1) == width * height);
+			}
+		}
+	}
+
+	GIVEN( "a square image with a power of two number of tiles" )
+	{
+		WHEN( "the tiles are in the Hilbert order" )
+		{
+			Array<Tile> tiles = createTiles(128, 128, 16, TileOrder::Hilbert);
+			THEN( "consecutive tiles are neighbours" )
+			{
+				for (int i = 1; i < (int)tiles.size(); ++i)
+				{
+					int distance = std::abs(tiles[i].x - tiles[i-1].x) + std::abs(tiles[i].y - tiles[i-1].y);
+					REQUIRE(distance == 16);
+				}
+			}
+		}
+
+		WHEN( "the tiles are in the spiral order" )
+		{
+			Array<Tile> tiles = createTiles(144, 144, 16, TileOrder::Spiral);
+			THEN( "the centre tile is first, then the ring around it, and the outer ring is last" )
+			{
+				REQUIRE(tiles.front().x == 64);
+				REQUIRE(tiles.front().y == 64);
+				for (int i = 1; i < 9; ++i)
+				{
+					REQUIRE(std::abs(tiles[i].x - 64) <= 16);
+					REQUIRE(std::abs(tiles[i].y - 64) <= 16);
+				}
+				for (int i = 81 - 32; i < 81; ++i)
+				{
+					REQUIRE((tiles[i].x == 0 || tiles[i].x == 128 || tiles[i].y == 0 || tiles[i].y == 128));
+				}
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "rae_ray/ReprojectionBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "rae/visual/Camera.hpp"
+
+using namespace rae;
+
+void ReprojectionBuffer::init(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_pixels.assign(width * height, FirstHits());
+}
+
+void ReprojectionBuffer::clear()
+{
+	std::fill(m_pixels.begin(), m_pixels.end(), FirstHits());
+}
+
+void ReprojectionBuffer::addFirstHit(int x, int y, bool isHit, const vec3& position)
+{
+	FirstHits& pixel = m_pixels[y * m_width + x];
+	pixel.sampleCount++;
+	if (isHit)
+	{
+		pixel.hitCount++;
+		pixel.position += (position - pixel.position) / float(pixel.hitCount);
+	}
+}
+
+void ReprojectionBuffer::copyPixel(const ReprojectionBuffer& source, int sourceX, int sourceY, int x, int y)
+{
+	m_pixels[y * m_width + x] = source.m_pixels[sourceY * source.m_width + sourceX];
+}
+
+bool ReprojectionBuffer::findHistory(
+	const Camera& previousCamera,
+	bool isHit,
+	const vec3& position,
+	const vec3& direction,
+	int& outX,
+	int& outY) const
+{
+	// The sky is infinitely far, so only the direction matters for it.
+	vec2 screen;
+	vec3 target = isHit ? position : previousCamera.position() + direction;
+	if (!previousCamera.projectToScreen(target, screen))
+		return false;
+
+	const int x = (int)std::floor(screen.x * float(m_width));
+	const int y = (int)std::floor(screen.y * float(m_height));
+	if (x < 0 || x >= m_width || y < 0 || y >= m_height)
+		return false;
+
+	const FirstHits& pixel = m_pixels[y * m_width + x];
+	if (pixel.sampleCount == 0)
+		return false;
+
+	if (!isHit)
+	{
+		if (pixel.hitCount != 0)
+			return false;
+	}
+	else
+	{
+		if (pixel.hitCount != pixel.sampleCount)
+			return false;
+
+		float distance = glm::length(position - previousCamera.position());
+		if (glm::length(pixel.position - position) > ReprojectionDistanceTolerance * distance)
+			return false;
+	}
+
+	outX = x;
+	outY = y;
+	return true;
+}
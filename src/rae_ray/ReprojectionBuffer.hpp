@@ -0,0 +1,61 @@
+#pragma once
+
+#include "rae/core/Types.hpp"
+
+namespace rae
+{
+
+class Camera;
+
+// When the camera moves, the pixels which still see the same surface keep this many of their samples.
+// It's below AdaptiveMinSamples, so that all the moved pixels get new samples before they count as converged.
+const int ReprojectedMaxSamples = 8;
+// How far the first hit of the old pixel can be from the surface seen by the new pixel, relative to the distance
+// from the camera, before it is taken as a different surface.
+const float ReprojectionDistanceTolerance = 0.05f;
+
+// The average first hit positions of the pixels of the ray tracer, for reprojecting the accumulated samples
+// to a new view when the camera moves. The depth along the view is the distance of the position from the camera.
+// The pixels where some of the samples missed the scene are on an edge of the sky, and have no valid history.
+// Usage example:
+// reprojection.addFirstHit(x, y, isHit, position); // For each sample.
+// reprojection.findHistory(oldCamera, isHit, position, direction, oldX, oldY); // For each pixel of the new view.
+class ReprojectionBuffer
+{
+public:
+	void init(int width, int height);
+	void clear();
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+
+	// The position is only used when the sample hit the scene.
+	void addFirstHit(int x, int y, bool isHit, const vec3& position);
+	void copyPixel(const ReprojectionBuffer& source, int sourceX, int sourceY, int x, int y);
+	void clearPixel(int x, int y) { m_pixels[y * m_width + x] = FirstHits(); }
+
+	// Finds the pixel of the previous view which saw the same thing as the centre ray of a new pixel. The isHit and
+	// position are the first hit of the centre ray, and the direction its direction. Returns false when the thing
+	// was outside of the previous view or hidden behind something else (disoccluded), or the pixel was on an edge.
+	bool findHistory(
+		const Camera& previousCamera,
+		bool isHit,
+		const vec3& position,
+		const vec3& direction,
+		int& outX,
+		int& outY) const;
+
+protected:
+	struct FirstHits
+	{
+		int sampleCount = 0;
+		int hitCount = 0;
+		vec3 position = vec3(0.0f, 0.0f, 0.0f); // The average of the hits.
+	};
+
+	int m_width = 0;
+	int m_height = 0;
+	Array<FirstHits> m_pixels;
+};
+
+} // namespace rae
@@ -0,0 +1,127 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/ReprojectionBuffer.hpp"
+#include "rae/visual/Camera.hpp"
+
+using namespace rae;
+
+namespace
+{
+
+// A wall at x = 0 below z = 1, and sky above it.
+bool hitWall(const Ray& ray, vec3& outPosition)
+{
+	if (ray.direction().x <= 0.0f)
+		return false;
+	float t = -ray.origin().x / ray.direction().x;
+	outPosition = ray.getPointAt(t);
+	return outPosition.z < 1.0f;
+}
+
+}
+
+SCENARIO("ReprojectionBuffer unittest", "[rae][ReprojectionBuffer]")
+{
+	GIVEN( "a camera looking at a wall" )
+	{
+		const int width = 64;
+		const int height = 36;
+
+		Camera camera(Math::toRadians(45.0f), float(width) / float(height), 0.0f, 10.0f);
+		camera.setPosition(vec3(-10.0f, 0.0f, 1.5f));
+		camera.calculateFrustum();
+
+		THEN( "projecting a point gives back the ray which goes through it" )
+		{
+			Camera turned = camera;
+			turned.setYaw(0.3f);
+			turned.setPitch(-0.2f);
+			turned.calculateFrustum();
+
+			Ray ray = turned.getExactRay(0.2f, 0.7f);
+			vec2 screen;
+			REQUIRE( turned.projectToScreen(ray.getPointAt(3.0f), screen) );
+			REQUIRE( screen.x == Approx(0.2f).epsilon(0.001) );
+			REQUIRE( screen.y == Approx(0.7f).epsilon(0.001) );
+
+			REQUIRE_FALSE( turned.projectToScreen(ray.getPointAt(-3.0f), screen) );
+		}
+
+		ReprojectionBuffer buffer;
+		buffer.init(width, height);
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				for (int sample = 0; sample < 4; ++sample)
+				{
+					float jitterX = 0.25f + 0.5f * float(sample % 2);
+					float jitterY = 0.25f + 0.5f * float(sample / 2);
+					vec3 position;
+					bool isHit = hitWall(camera.getExactRay(
+						(float(x) + jitterX) / float(width), (float(y) + jitterY) / float(height)), position);
+					buffer.addFirstHit(x, y, isHit, position);
+				}
+			}
+		}
+
+		WHEN( "the camera moves sideways" )
+		{
+			Camera moved = camera;
+			moved.setPosition(camera.position() + vec3(0.0f, 0.3f, 0.0f));
+			moved.calculateFrustum();
+
+			int validCount = 0;
+			int edgeCount = 0;
+			for (int y = 0; y < height; ++y)
+			{
+				for (int x = 0; x < width; ++x)
+				{
+					Ray ray = moved.getExactRay((float(x) + 0.5f) / float(width), (float(y) + 0.5f) / float(height));
+					vec3 position;
+					bool isHit = hitWall(ray, position);
+
+					int sourceX = -1;
+					int sourceY = -1;
+					if (buffer.findHistory(camera, isHit, position, glm::normalize(ray.direction()), sourceX, sourceY))
+					{
+						validCount++;
+						// From the old camera on the right, the wall was further left on the screen. The sky stays put.
+						if (isHit)
+							REQUIRE( sourceX <= x );
+						else REQUIRE( sourceX == x );
+						REQUIRE( sourceY == y );
+					}
+					else if (position.z > 0.9f && position.z < 1.1f)
+					{
+						edgeCount++;
+					}
+				}
+			}
+
+			THEN( "most of the pixels keep their history, but the edge of the sky doesn't" )
+			{
+				REQUIRE( validCount > width * height * 8 / 10 );
+				REQUIRE( edgeCount > 0 );
+			}
+
+			THEN( "something in front of the wall has no history" )
+			{
+				Ray ray = moved.getExactRay(0.5f, 0.8f);
+				vec3 position;
+				REQUIRE( hitWall(ray, position) );
+
+				int sourceX = -1;
+				int sourceY = -1;
+				REQUIRE( buffer.findHistory(camera, true, position, glm::normalize(ray.direction()), sourceX, sourceY) );
+				REQUIRE_FALSE( buffer.findHistory(
+					camera, true, ray.getPointAt(0.5f), glm::normalize(ray.direction()), sourceX, sourceY) );
+			}
+		}
+	}
+}
+
+#endif
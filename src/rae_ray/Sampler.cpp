@@ -0,0 +1,200 @@
+#include "rae_ray/Sampler.hpp"
+
+#include <cmath>
+
+namespace rae
+{
+
+namespace
+{
+
+const float UintToFloat = 1.0f / 16777216.0f;
+
+// The top 24 bits fill the mantissa of a float exactly, so this can't round up to 1.
+float toUnitFloat(uint32_t value)
+{
+	return float(value >> 8) * UintToFloat;
+}
+
+uint32_t hashUint(uint32_t value)
+{
+	// lowbias32 from Chris Wellons' hash prospector.
+	value ^= value >> 16;
+	value *= 0x7feb352du;
+	value ^= value >> 15;
+	value *= 0x846ca68bu;
+	value ^= value >> 16;
+	return value;
+}
+
+uint32_t hashCombine(uint32_t seed, uint32_t value)
+{
+	return seed ^ (value + (seed << 6) + (seed >> 2));
+}
+
+uint32_t reverseBits(uint32_t value)
+{
+	value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+	value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+	value = ((value >> 4) & 0x0f0f0f0fu) | ((value & 0x0f0f0f0fu) << 4);
+	value = ((value >> 8) & 0x00ff00ffu) | ((value & 0x00ff00ffu) << 8);
+	return (value >> 16) | (value << 16);
+}
+
+uint32_t laineKarrasPermutation(uint32_t value, uint32_t seed)
+{
+	value += seed;
+	value ^= value * 0x6c50b47cu;
+	value ^= value * 0xb82f1e52u;
+	value ^= value * 0xc7afe638u;
+	value ^= value * 0x8d22f6e6u;
+	return value;
+}
+
+// Owen scrambling: a random permutation of each subtree of the binary digits, so that the stratification stays.
+uint32_t nestedUniformScramble(uint32_t value, uint32_t seed)
+{
+	return reverseBits(laineKarrasPermutation(reverseBits(value), seed));
+}
+
+// The first two dimensions of Sobol form a (0, 2)-sequence, where every power of two prefix is stratified in 2D.
+// The higher dimensions have worse 2D projections, so the sampler only uses these two, scrambled differently
+// for each pair of dimensions ("padding").
+const int SobolDimensions = 2;
+const int SobolBits = 32;
+
+struct SobolMatrices
+{
+	uint32_t directions[SobolDimensions][SobolBits];
+
+	SobolMatrices()
+	{
+		// The first dimension is the van der Corput sequence, and the second one comes from the primitive
+		// polynomial x + 1, for which the direction numbers are v[k] = v[k-1] ^ (v[k-1] >> 1).
+		for (int k = 0; k < SobolBits; ++k)
+		{
+			directions[0][k] = 1u << (31 - k);
+			directions[1][k] = (k == 0) ? (1u << 31) : (directions[1][k - 1] ^ (directions[1][k - 1] >> 1));
+		}
+	}
+};
+
+const SobolMatrices& sobolMatrices()
+{
+	static const SobolMatrices matrices;
+	return matrices;
+}
+
+// The fractional parts of the square roots of the first primes, which are irrational and so make
+// Kronecker sequences which never repeat. Each dimension has its own, so the dimensions are not correlated.
+const int KroneckerDimensions = 32;
+
+double kroneckerAlpha(int dimension)
+{
+	static const int primes[KroneckerDimensions] =
+	{
+		2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+		59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131
+	};
+	double root = std::sqrt(double(primes[dimension]));
+	return root - std::floor(root);
+}
+
+// Interleaved gradient noise, from Jimenez 2014, "Next Generation Post Processing in Call of Duty: Advanced Warfare".
+float interleavedGradientNoise(float x, float y)
+{
+	float value = 0.06711056f * x + 0.00583715f * y;
+	value = 52.9829189f * (value - std::floor(value));
+	return value - std::floor(value);
+}
+
+} // namespace
+
+String toString(SamplerType type)
+{
+	switch (type)
+	{
+		case SamplerType::Random:		return "Random";
+		case SamplerType::Sobol:		return "Sobol";
+		case SamplerType::BlueNoise:	return "Blue noise";
+		default:						return "Unknown";
+	}
+}
+
+std::unique_ptr<Sampler> createSampler(SamplerType type)
+{
+	switch (type)
+	{
+		case SamplerType::Sobol:		return std::unique_ptr<Sampler>(new SobolSampler());
+		case SamplerType::BlueNoise:	return std::unique_ptr<Sampler>(new BlueNoiseSampler());
+		case SamplerType::Random:
+		default:						return std::unique_ptr<Sampler>(new RandomSampler());
+	}
+}
+
+void RandomSampler::startPixelSample(int x, int y, int sampleIndex, uint64_t seed)
+{
+	seedThreadRandom(randomSeed((uint64_t(uint32_t(y)) << 32) | uint32_t(x), sampleIndex, seed));
+}
+
+uint32_t SobolSampler::sobol(uint32_t index, int dimension)
+{
+	const uint32_t* v = sobolMatrices().directions[dimension];
+	uint32_t result = 0;
+	for (int bit = 0; index != 0; index >>= 1, ++bit)
+	{
+		if (index & 1u)
+			result ^= v[bit];
+	}
+	return result;
+}
+
+void SobolSampler::startPixelSample(int x, int y, int sampleIndex, uint64_t seed)
+{
+	m_pixelSeed = uint32_t(randomSeed((uint64_t(uint32_t(y)) << 32) | uint32_t(x), seed));
+	m_sampleIndex = uint32_t(sampleIndex);
+}
+
+float SobolSampler::get1D(int dimension)
+{
+	const uint32_t group = uint32_t(dimension / SobolDimensions);
+	const int groupDimension = dimension % SobolDimensions;
+	const uint32_t groupSeed = hashUint(hashCombine(m_pixelSeed, group));
+
+	// Shuffle the samples of the pixel differently for each pair, so that the pairs are not correlated.
+	uint32_t index = nestedUniformScramble(m_sampleIndex, groupSeed);
+	uint32_t value = sobol(index, groupDimension);
+	value = nestedUniformScramble(value, hashUint(hashCombine(groupSeed, uint32_t(groupDimension))));
+	return toUnitFloat(value);
+}
+
+void BlueNoiseSampler::startPixelSample(int x, int y, int sampleIndex, uint64_t seed)
+{
+	m_x = x;
+	m_y = y;
+	m_sampleIndex = uint32_t(sampleIndex);
+	m_seed = uint32_t(randomSeed(seed));
+}
+
+float BlueNoiseSampler::get1D(int dimension)
+{
+	if (dimension >= KroneckerDimensions)
+	{
+		// The deep bounces contribute so little that plain random numbers are enough.
+		uint32_t hash = hashUint(hashCombine(hashCombine(hashCombine(m_seed, uint32_t(dimension)),
+			uint32_t(m_x) * 73856093u ^ uint32_t(m_y) * 19349663u), m_sampleIndex));
+		return toUnitFloat(hash);
+	}
+
+	// Move the noise pattern by a different amount for each dimension, so that the offsets
+	// of the dimensions are not the same. 5.588238 is the shift used for animating the noise in the paper.
+	const float shift = 5.588238f * float(dimension + 1 + (m_seed & 0xffu));
+	const float offset = interleavedGradientNoise(float(m_x) + shift, float(m_y) + shift * 0.5f);
+
+	double value = double(offset) + kroneckerAlpha(dimension) * double(m_sampleIndex);
+	float result = float(value - std::floor(value));
+	// Rounding can give exactly 1 for values just below it.
+	return result < 1.0f ? result : 0.0f;
+}
+
+} // namespace rae
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory>
+
+#include "rae/core/Types.hpp"
+#include "rae/core/Random.hpp"
+
+namespace rae
+{
+
+enum class SamplerType
+{
+	Random,		// Independent uniform random numbers.
+	Sobol,		// Shuffled and Owen scrambled Sobol sequence.
+	BlueNoise,	// Kronecker sequences, offset per pixel with screen space blue noise.
+	Count
+};
+
+String toString(SamplerType type);
+
+// The dimensions of a pixel sample. Each part of the path always uses the same dimensions, so that e.g. the
+// lens samples of a pixel are well distributed between themselves, regardless of what happened before them.
+// The 2D samples start at even dimensions, as the Sobol sampler generates the dimensions in pairs.
+const int PixelDimension = 0; // 2D jitter inside the pixel.
+const int LensDimension = 2; // 2D depth of field.
+const int BounceDimension = 4; // The start of the first bounce.
+const int ScatterDimension = 0; // 3D scattering, from the start of a bounce.
+const int LightChoiceDimension = 3; // 1D choice of the light to sample, from the start of a bounce.
+const int RouletteDimension = 4; // 1D Russian roulette, from the start of a bounce.
+const int LightDirectionDimension = 6; // 2D direction towards the light, from the start of a bounce.
+const int DimensionsPerBounce = 8;
+
+inline int bounceDimension(int bounce, int offset)
+{
+	return BounceDimension + bounce * DimensionsPerBounce + offset;
+}
+
+// Gives the numbers in [0, 1) for one pixel sample, one dimension at a time.
+// Usage example:
+// sampler->startPixelSample(x, y, sampleIndex, seed);
+// vec2 jitter = sampler->get2D(PixelDimension);
+class Sampler
+{
+public:
+	virtual ~Sampler() {}
+
+	virtual SamplerType type() const = 0;
+
+	// Called before the first number of each pixel sample. The seed makes the scrambling different between renders.
+	virtual void startPixelSample(int x, int y, int sampleIndex, uint64_t seed) = 0;
+	virtual float get1D(int dimension) = 0;
+
+	vec2 get2D(int dimension)
+	{
+		float first = get1D(dimension);
+		return vec2(first, get1D(dimension + 1));
+	}
+
+	vec3 get3D(int dimension)
+	{
+		float first = get1D(dimension);
+		float second = get1D(dimension + 1);
+		return vec3(first, second, get1D(dimension + 2));
+	}
+};
+
+std::unique_ptr<Sampler> createSampler(SamplerType type);
+
+// Uses the PCG generator of the thread (threadRandom), seeded for each pixel sample. This is how the ray tracer
+// sampled before there were samplers, so it's the baseline for the others. The dimensions are ignored.
+class RandomSampler : public Sampler
+{
+public:
+	SamplerType type() const override { return SamplerType::Random; }
+	void startPixelSample(int x, int y, int sampleIndex, uint64_t seed) override;
+	float get1D(int dimension) override { return getRandom(); }
+};
+
+// Sobol points with the hash based shuffling and Owen scrambling from Burley 2020, "Practical Hash-based Owen
+// Scrambling". Each pair of dimensions is a 2D Sobol point with its own shuffling and scrambling, so any number of
+// dimensions can be used, and each power of two prefix of the samples of a pixel is stratified in each pair,
+// which suits the progressive rendering where the sample count isn't known in advance.
+class SobolSampler : public Sampler
+{
+public:
+	SamplerType type() const override { return SamplerType::Sobol; }
+	void startPixelSample(int x, int y, int sampleIndex, uint64_t seed) override;
+	float get1D(int dimension) override;
+
+	// The unscrambled Sobol sequence, for the first two dimensions.
+	static uint32_t sobol(uint32_t index, int dimension);
+
+protected:
+	uint32_t m_pixelSeed = 0;
+	uint32_t m_sampleIndex = 0;
+};
+
+// Kronecker (additive recurrence) sequences, which are offset for each pixel with interleaved gradient noise
+// (Jimenez 2014). The noise has most of its energy in the high frequencies like blue noise, so the remaining error
+// looks like fine grain instead of blotches at low sample counts. It's computed from the pixel coordinates,
+// so there's no blue noise texture to load.
+class BlueNoiseSampler : public Sampler
+{
+public:
+	SamplerType type() const override { return SamplerType::BlueNoise; }
+	void startPixelSample(int x, int y, int sampleIndex, uint64_t seed) override;
+	float get1D(int dimension) override;
+
+protected:
+	int m_x = 0;
+	int m_y = 0;
+	uint32_t m_sampleIndex = 0;
+	uint32_t m_seed = 0;
+};
+
+} // namespace rae
@@ -0,0 +1,136 @@
+#include "rae/core/version.hpp"
+
+#ifdef version_catch
+#include "rae/core/catch.hpp"
+
+#include "rae_ray/Sampler.hpp"
+
+#include "loguru/loguru.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace rae;
+
+SCENARIO("Sampler unittest", "[rae][Sampler]")
+{
+	GIVEN( "each type of sampler" )
+	{
+		for (int i = 0; i < (int)SamplerType::Count; ++i)
+		{
+			std::unique_ptr<Sampler> sampler = createSampler((SamplerType)i);
+			REQUIRE(sampler->type() == (SamplerType)i);
+
+			auto generate = [&]()
+			{
+				Array<float> values;
+				for (int sample = 0; sample < 64; ++sample)
+				{
+					sampler->startPixelSample(3, 5, sample, 11);
+					for (int dimension = 0; dimension < 100; ++dimension)
+					{
+						values.emplace_back(sampler->get1D(dimension));
+					}
+				}
+				return values;
+			};
+
+			THEN( "the " + toString(sampler->type()) + " sampler gives the same numbers in [0, 1) for the same pixel sample" )
+			{
+				Array<float> values = generate();
+				REQUIRE(std::all_of(values.begin(), values.end(), [](float value)
+				{
+					return value >= 0.0f && value < 1.0f;
+				}));
+				REQUIRE(values == generate());
+			}
+		}
+	}
+
+	GIVEN( "the Sobol sampler" )
+	{
+		SobolSampler sampler;
+
+		THEN( "each power of two prefix of the samples of a pixel is stratified in 2D" )
+		{
+			for (int count = 4; count <= 64; count *= 4)
+			{
+				const int cellsPerAxis = (int)std::sqrt(float(count));
+				Array<int> pixelCells(count, 0);
+				Array<int> lensCells(count, 0);
+				for (int sample = 0; sample < count; ++sample)
+				{
+					sampler.startPixelSample(7, 2, sample, 0);
+					vec2 pixel = sampler.get2D(PixelDimension);
+					vec2 lens = sampler.get2D(LensDimension);
+					pixelCells[int(pixel.y * cellsPerAxis) * cellsPerAxis + int(pixel.x * cellsPerAxis)]++;
+					lensCells[int(lens.y * cellsPerAxis) * cellsPerAxis + int(lens.x * cellsPerAxis)]++;
+				}
+				REQUIRE(std::count(pixelCells.begin(), pixelCells.end(), 1) == count);
+				REQUIRE(std::count(lensCells.begin(), lensCells.end(), 1) == count);
+			}
+		}
+
+		THEN( "the unscrambled sequence starts with the known points" )
+		{
+			REQUIRE(SobolSampler::sobol(1, 0) == 0x80000000u);
+			REQUIRE(SobolSampler::sobol(2, 0) == 0x40000000u);
+			REQUIRE(SobolSampler::sobol(3, 1) == 0x40000000u);
+			REQUIRE(SobolSampler::sobol(2, 1) == 0xc0000000u);
+		}
+	}
+}
+
+// Hidden from the default test run. Run with: ./pihlaja "[benchmark]"
+SCENARIO("Sampler convergence benchmark", "[.][benchmark][Sampler]")
+{
+	// A pixel with an edge in the pixel dimensions, and a smooth falloff in the lens dimensions,
+	// like a defocused edge. The exact value is known, so the error of each pixel can be measured.
+	auto integrand = [](const vec2& pixel, const vec2& lens) -> float
+	{
+		float inside = glm::length(pixel - vec2(0.5f, 0.5f)) < 0.4f ? 1.0f : 0.0f;
+		return inside * lens.x * lens.y;
+	};
+	const float exact = float(M_PI) * 0.16f * 0.25f;
+
+	const int PixelCount = 4096;
+	const int MaxSamples = 1024;
+
+	Array<float> errorsAt1024;
+	for (int i = 0; i < (int)SamplerType::Count; ++i)
+	{
+		std::unique_ptr<Sampler> sampler = createSampler((SamplerType)i);
+
+		Array<double> sums(PixelCount, 0.0);
+		float rmse = 0.0f;
+		for (int samples = 1; samples <= MaxSamples; ++samples)
+		{
+			double squaredError = 0.0;
+			for (int pixel = 0; pixel < PixelCount; ++pixel)
+			{
+				sampler->startPixelSample(pixel % 64, pixel / 64, samples - 1, 0);
+				vec2 pixelSample = sampler->get2D(PixelDimension);
+				sums[pixel] += integrand(pixelSample, sampler->get2D(LensDimension));
+
+				double error = sums[pixel] / double(samples) - double(exact);
+				squaredError += error * error;
+			}
+			rmse = (float)std::sqrt(squaredError / double(PixelCount));
+
+			if ((samples & (samples - 1)) == 0 && samples >= 4)
+			{
+				LOG_F(INFO, "%s: %i spp RMSE %f", toString(sampler->type()).c_str(), samples, rmse);
+			}
+		}
+		errorsAt1024.emplace_back(rmse);
+	}
+
+	LOG_F(INFO, "Error vs Random at %i spp: Sobol %fx, Blue noise %fx", MaxSamples,
+		errorsAt1024[(int)SamplerType::Sobol] / errorsAt1024[(int)SamplerType::Random],
+		errorsAt1024[(int)SamplerType::BlueNoise] / errorsAt1024[(int)SamplerType::Random]);
+
+	REQUIRE(errorsAt1024[(int)SamplerType::Sobol] < errorsAt1024[(int)SamplerType::Random]);
+	REQUIRE(errorsAt1024[(int)SamplerType::BlueNoise] < errorsAt1024[(int)SamplerType::Random]);
+}
+
+#endif